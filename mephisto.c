@@ -19,29 +19,77 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <math.h>
+#include <float.h>
 #include <inttypes.h>
 #include <errno.h>
 #include <string.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <limits.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
 #include <inttypes.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include <mephisto.h>
+#include <mephisto_kernel.h>
+#include <mephisto_pool.h>
 #include <props.h>
 #include <timely.h>
 #include <varchunk.h>
 
 #include <faust/dsp/llvm-c-dsp.h>
+#if defined(_FAUST_HAS_INTERPRETER)
+#	include <faust/dsp/interpreter-dsp-c.h>
+#endif
 
 #define MAX_CHANNEL 8
+#define MAX_IO 64
 #define MAX_VOICES 64
-
-//#define MDI_MPE
+#define NSTATS 7
+#define SCHED_QUEUE_MAX 64
+#define SCHED_POLL_NS 20000000 // 20 ms
+#define COMPILE_ERROR_SIZE 0x1000 // 4 K
+#define CACHE_SIZE_MAX (INT64_C(256) << 20) // 256 M
+#define ARGV_MAX 32
+#define COMPILE_OPTIONS_DEFAULT "-vec -lv 1"
+#define PARALLEL_OPTION "-sch"
+#define TUNE_WARMUP 8
+#define TUNE_ROUNDS 5
+#define TUNE_BLOCKS 32
+#define SPAWN_THREADS_MAX 8
+#define LAZY_WARM 4
+#define MEMORY_ALIGN 64
+#define SILENCE_THRESHOLD_DEFAULT -90.f // dB
+#define SILENCE_BLOCKS_DEFAULT 16
+#define SILENCE_BLOCKS_MAX 1024
+#define BLOCK_LENGTH_MAX 4096
+#define ZONE_NONE 0xff
+#define ZONE_RANGE_MANAGER 2.f // semitones
+#define ZONE_RANGE_MEMBER 48.f // semitones
+#define JOB_PAYLOAD_MAX 0x400
+#define BEND_SEMI_MAX 0x80 // semitones
+#define BEND_FINE 0x400 // steps per semitone
+#define SCALA_NOTES_MAX 0x100
+#define MTS_BULK_SIZE 408 // bytes
 
 typedef union _hash_t hash_t;
 typedef struct _voice_t voice_t;
+typedef struct _voice_link_t voice_link_t;
+typedef struct _voice_list_t voice_list_t;
+typedef struct _carry_t carry_t;
+typedef struct _zone_t zone_t;
+typedef struct _tuning_t tuning_t;
+typedef struct _factory_t factory_t;
 typedef struct _dsp_t dsp_t;
+typedef struct _args_t args_t;
+typedef struct _stats_t stats_t;
+typedef struct _spawn_t spawn_t;
+typedef struct _voice_lane_t voice_lane_t;
+typedef struct _voice_pool_t voice_pool_t;
 typedef struct _job_t job_t;
 typedef struct _pos_t pos_t;
 typedef struct _plughandle_t plughandle_t;
@@ -110,12 +158,40 @@ struct _cntrl_t {
 	};
 };
 
+typedef enum _tier_t {
+	TIER_LLVM        = 0,
+	TIER_INTERPRETER = 1
+} tier_t;
+
 typedef enum _voice_state_t {
 	VOICE_STATE_INACTIVE     = 0,
 	VOICE_STATE_ACTIVE       = (1 << 0),
 	VOICE_STATE_SUSTAIN      = (1 << 1)
 } voice_state_t;
 
+typedef enum _list_t {
+	LIST_STATE = 0, // idle or busy
+	LIST_CHANNEL, // busy on a given channel
+
+	LIST_MAX
+} list_t;
+
+typedef enum _steal_t {
+	STEAL_OLDEST = 0,
+	STEAL_QUIETEST,
+	STEAL_SAMEKEY
+} steal_t;
+
+// MPE zone, lower zone is managed on channel 1, upper zone on channel 16
+struct _zone_t {
+	uint8_t manager; // channel
+	uint8_t members; // number of member channels, 0 if disabled
+};
+
+struct _tuning_t {
+	float freq [0x10][0x80]; // per channel and key, in Hz
+};
+
 union _hash_t {
 	struct {
 		uint8_t chn;
@@ -135,8 +211,18 @@ struct _pos_t {
 	cntrl_t speed;
 };
 
+struct _voice_link_t {
+	voice_t *prev;
+	voice_t *next;
+};
+
 struct _voice_t {
-	llvm_dsp *instance;
+	union {
+		llvm_dsp *instance;
+#if defined(_FAUST_HAS_INTERPRETER)
+		interpreter_dsp *interpreter;
+#endif
+	};
 
 	cntrl_t gate;
 	cntrl_t gain;
@@ -154,24 +240,138 @@ struct _voice_t {
 	voice_state_t state;
 	hash_t hash;
 	bool retrigger;
+	bool parked;
+	uint32_t silent; // consecutive blocks
+	float peak; // of the last block, if tracked
+
+	voice_link_t links [LIST_MAX];
+};
+
+struct _voice_list_t {
+	voice_t *head;
+	voice_t *tail;
+};
+
+// a held note waiting for its voice to be published
+struct _carry_t {
+	hash_t hash;
+	voice_state_t state;
+	float gate;
+	float gain;
+	float freq;
+	float pressure;
+	float timbre;
+	float d_freq;
+	float d_pressure;
+	float d_timbre;
+};
+
+struct _factory_t {
+	factory_t *next;
+	uint64_t key;
+	char *source; // code, arguments and target, verifies key matches
+	size_t source_len;
+	uint32_t refs;
+	llvm_dsp_factory *factory;
+	char *error;
+	int64_t size;
+	uint32_t srate; // static tables are initialized for
+#if defined(_FAUST_HAS_MEMORY_MANAGER)
+	factory_t *owner; // of the static tables and memory manager, may be itself
+	llvm_dsp_factory *tables; // libFAUST factory whose tables this one owns
+	MemoryManagerGlue manager;
+	_Atomic int64_t allocated; // bytes
+#endif
+};
+
+struct _stats_t {
+	uint64_t factory; // ns
+	uint64_t instance; // ns
+	uint64_t init; // ns
+	uint64_t clone; // ns
+	uint64_t ui; // ns
+	int64_t memory_factory; // bytes
+	int64_t memory_instances; // bytes
 };
 
 struct _dsp_t {
 	plughandle_t *handle;
-	llvm_dsp_factory *factory;
+	tier_t tier;
+	factory_t *factory;
+#if defined(_FAUST_HAS_INTERPRETER)
+	interpreter_dsp_factory *interpreter_factory;
+#endif
 	UIGlue ui_glue;
 	MetaGlue meta_glue;
 	uint32_t nins;
 	uint32_t nouts;
 	uint32_t nvoices;
 	uint32_t cvoices;
+	uint32_t nlazy;
+	int64_t memory_voice; // bytes per instance, via the memory manager
+	_Atomic uint32_t nready;
+	uint32_t nsynced; // snapshot of nready, voices rt-thread works with
 	voice_t voices [MAX_VOICES];
+	carry_t carry [MAX_VOICES];
+	uint32_t icarry;
+	uint32_t ncarry;
+	uint8_t active [0x10][0x80]; // voice index + 1 of active notes, 0 if none
+	voice_list_t idle; // inactive voices, longest idle first
+	voice_list_t busy; // active and sustained voices, oldest first
+	voice_list_t channel [0x10]; // busy voices per channel, oldest first
+	uint32_t nlisted;
+	steal_t steal;
 	bool midi_on;
 	bool time_on;
 	bool is_instrument;
 	timely_mask_t timely_mask;
 	int32_t idx;
-	uint32_t ivoice;
+	char compile_options [OPTIONS_SIZE];
+	char machine [TARGET_SIZE];
+	stats_t stats;
+};
+
+struct _spawn_t {
+	dsp_t *dsp;
+	voice_t *base_voice;
+	int srate;
+	uint32_t first;
+	uint32_t last;
+	uint32_t done;
+	pthread_t thread;
+};
+
+struct _voice_lane_t {
+	FAUSTFLOAT *out [MAX_CHANNEL]; // sum of all voices of this lane
+	FAUSTFLOAT *scratch [MAX_CHANNEL]; // single voice
+	FAUSTFLOAT *surplus; // backs surplus DSP outputs
+	bool rendered;
+};
+
+struct _voice_pool_t {
+	plughandle_t *handle;
+	pool_t *pool;
+	voice_lane_t lanes [POOL_THREADS_MAX];
+
+	// current batch of voices, set up by the rt-thread before each run
+	dsp_t *dsp;
+	voice_t *voices [MAX_VOICES];
+	uint32_t nvoices;
+	_Atomic uint32_t next;
+	FAUSTFLOAT **inputs;
+	uint32_t nouts;
+	uint32_t nsamples;
+};
+
+struct _args_t {
+	char options [OPTIONS_SIZE];
+	char tuned_options [OPTIONS_SIZE];
+	char compile_options [OPTIONS_SIZE];
+	char tokens [3][OPTIONS_SIZE]; // split up copies of the above
+	bool parallel;
+	const char *argv [ARGV_MAX];
+	int argc;
+	const char *machine;
 };
 
 typedef enum _job_type_t {
@@ -179,7 +379,16 @@ typedef enum _job_type_t {
 	JOB_TYPE_DEINIT,
 	JOB_TYPE_ERROR_CLEAR,
 	JOB_TYPE_ERROR_APPEND,
-	JOB_TYPE_ERROR_FREE
+	JOB_TYPE_ERROR_FREE,
+	JOB_TYPE_QUEUE,
+	JOB_TYPE_TUNE,
+	JOB_TYPE_TUNE_FREE,
+	JOB_TYPE_POOL,
+	JOB_TYPE_POOL_FREE,
+	JOB_TYPE_SCALA,
+	JOB_TYPE_MTS,
+	JOB_TYPE_TUNING,
+	JOB_TYPE_TUNING_FREE
 } job_type_t;
 
 struct _job_t {
@@ -187,6 +396,12 @@ struct _job_t {
 	union {
 		dsp_t *dsp;
 		char *error;
+		uint32_t depth;
+		char *options;
+		uint32_t nlanes;
+		voice_pool_t *pool;
+		tuning_t *tuning;
+		uint32_t size; // of the payload following the job
 	};
 };
 
@@ -201,7 +416,7 @@ struct _plughandle_t {
 
 	LV2_URID midi_MidiEvent;
 
-	char dsp_dir [FILENAME_MAX];
+	char cache_dir [PATH_MAX];
 
 	plugstate_t state;
 	plugstate_t stash;
@@ -210,6 +425,7 @@ struct _plughandle_t {
 	LV2_Atom_Sequence *notify;
 	const float *audio_in [MAX_CHANNEL];
 	float *audio_out [MAX_CHANNEL];
+	float *latency;
 	unsigned nchannel;
 
 	PROPS_T(props, MAX_NPROPS);
@@ -218,12 +434,28 @@ struct _plughandle_t {
 
 	uint32_t xfade_max;
 	uint32_t xfade_cur;
+	dsp_t *held_dsp; // installed once the crossfade in progress has finished
 
 	uint32_t srate;
 	char bundle_path [PATH_MAX];
 
+	LV2_URID mephisto_code;
 	LV2_URID mephisto_error;
 	LV2_URID mephisto_timestamp;
+	LV2_URID mephisto_compileQueue;
+	LV2_URID mephisto_compileOptions;
+	LV2_URID mephisto_autoTune;
+	LV2_URID mephisto_tunedOptions;
+	LV2_URID mephisto_target;
+	LV2_URID mephisto_stats [NSTATS];
+	LV2_URID mephisto_silenceThreshold;
+	LV2_URID mephisto_silenceBlocks;
+	LV2_URID mephisto_parkedVoices;
+	LV2_URID mephisto_quantization;
+	LV2_URID mephisto_blockLength;
+	LV2_URID mephisto_voiceThreads;
+	LV2_URID mephisto_voiceLoad;
+	LV2_URID mephisto_parallel;
 	LV2_URID mephisto_control [NCONTROLS];
 	LV2_URID mephisto_controlMin [NCONTROLS];
 	LV2_URID mephisto_controlMax [NCONTROLS];
@@ -234,8 +466,19 @@ struct _plughandle_t {
 	struct {
 		bool error;
 		bool attributes;
+		bool queue;
+		bool tune;
+		bool target;
+		bool stats;
+		bool quantization;
+		bool block_length;
+		bool silence_blocks;
+		bool voice_threads;
+		bool load;
 	} dirty;
 
+	float silence_level;
+
 	bool play;
 	dsp_t *dsp [2];
 
@@ -246,15 +489,87 @@ struct _plughandle_t {
 	uint16_t timbre [0x10];
 	float bend [0x10];
 	float range [0x10];
+	float bend_factor [0x10];
 	bool sustain [0x10];
+	zone_t zones [2];
+	uint8_t manager [0x10]; // manager channel of member channels or ZONE_NONE
+	tuning_t *tuning;
+	tuning_t tuning_edit; // worker-thread, copied into the above on changes
 
 	timely_t timely;
 
 	FAUSTFLOAT *faudio_in [MAX_CHANNEL];
 	FAUSTFLOAT *faudio_out [MAX_CHANNEL];
+	kernel_t kernel;
+	FAUSTFLOAT *silence; // backs surplus DSP inputs
+	FAUSTFLOAT *scratch; // backs surplus DSP outputs
+	uint32_t max_block_length;
+	uint32_t nominal_block_length;
+	bool fixed_block_length;
+
+	// renders in internal blocks of state.block_length
+	FAUSTFLOAT *fifo_in [MAX_CHANNEL];
+	FAUSTFLOAT *fifo_out [MAX_CHANNEL];
+	uint32_t fifo_pos;
+	uint32_t fifo_latency;
+
+	// renders voices in parallel if set
+	voice_pool_t *pool;
+	uint64_t pool_busy [POOL_THREADS_MAX]; // ns
+	uint64_t pool_frames;
+
+	// worker thread only
+	char *payload;
+	factory_t *tuned;
+
+	// handed over from the state restore thread
+	_Atomic(dsp_t *) restored_dsp;
+	_Atomic(char *) restored_payload;
+	bool skip_submit;
+	bool skipped_submit;
+	bool idling; // property callbacks from props_idle stem from state restore
+};
+
+typedef struct _sched_entry_t sched_entry_t;
+
+struct _sched_entry_t {
+	sched_entry_t *next;
 };
 
+// guards the factory registry and the compile scheduler, never held while
+// calling into libFAUST
 static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static factory_t *factories = NULL;
+static struct {
+	sched_entry_t *head; // waiting compilations in FIFO order
+	uint32_t slots;
+	uint32_t queued;
+	uint32_t running;
+} sched;
+
+// libFAUST guards its compiler and factory cache within each API call, thus
+// factories are built, read, written and deleted concurrently. Not guarded are
+// the memory manager setup and class initialization of a factory, which write
+// the static tables shared by all of its instances: these are only run by the
+// owner of the tables before the factory gets published, see _factory_claim,
+// and serialized on faust_lock. Creating, cloning, initializing, computing and
+// deleting instances only touch the instance and the factory's atomic
+// allocation counters, thus never wait for a compilation
+static pthread_mutex_t faust_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t ncpus = 1;
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static __thread bool restoring = false;
+#if defined(_FAUST_HAS_MEMORY_MANAGER)
+static __thread int64_t allocated = 0; // by this thread via memory managers
+#endif
+static char machine_target [TARGET_SIZE];
+static char dsp_dir [PATH_MAX];
+static char native_target [TARGET_SIZE];
+static float key_freq [0x80]; // 12-TET at A4 = 440 Hz
+static float bend_coarse [2*BEND_SEMI_MAX + 1];
+static float bend_fine [BEND_FINE];
 
 #if 0
 #	define DBG(HANDLE, FMT, ...) \
@@ -276,12 +591,20 @@ _voice_begin(dsp_t *dsp)
 	return dsp->voices;
 }
 
+// number of voices created and published by the worker thread
+static inline uint32_t
+_voice_ready(dsp_t *dsp)
+{
+	return atomic_load_explicit(&dsp->nready, memory_order_acquire);
+}
+
+// rt-thread, voices published mid-cycle are only seen from the next one on
 static inline bool
 _voice_not_end(dsp_t *dsp, voice_t *voice)
 {
 	const uint32_t voice_offset = voice - dsp->voices;
 
-	return voice_offset < dsp->nvoices;
+	return voice_offset < dsp->nsynced;
 }
 
 static inline voice_t *
@@ -295,2088 +618,6556 @@ _voice_next(voice_t *voice)
 		_voice_not_end((DSP), (VOICE)); \
 		(VOICE) = _voice_next((VOICE)))
 
-static void
-_intercept_code(void *data, int64_t frames __attribute__((unused)),
-	props_impl_t *impl)
+#define VOICE_LIST_FOREACH(LIST, L, VOICE) \
+	for(voice_t *(VOICE) = (LIST)->head; \
+		(VOICE); \
+		(VOICE) = (VOICE)->links[(L)].next)
+
+static inline void
+_voice_list_append(voice_list_t *list, list_t l, voice_t *voice)
 {
-	plughandle_t *handle = data;
+	voice_link_t *link = &voice->links[l];
 
-	char *code;
-	if( (code = varchunk_write_request(handle->to_worker, impl->value.size)) )
+	link->prev = list->tail;
+	link->next = NULL;
+
+	if(list->tail)
+	{
+		list->tail->links[l].next = voice;
+	}
+	else
 	{
-		memcpy(code, handle->state.code, impl->value.size);
+		list->head = voice;
+	}
 
-		varchunk_write_advance(handle->to_worker, impl->value.size);
+	list->tail = voice;
+}
 
-		const job_t job = {
-			.type = JOB_TYPE_INIT
-		};
-		handle->sched->schedule_work(handle->sched->handle, sizeof(job), &job);
+static inline void
+_voice_list_remove(voice_list_t *list, list_t l, voice_t *voice)
+{
+	voice_link_t *link = &voice->links[l];
+
+	if(link->prev)
+	{
+		link->prev->links[l].next = link->next;
 	}
-	else if(handle->log)
+	else
 	{
-		lv2_log_trace(&handle->logger, "[%s] ringbuffer overflow\n", __func__);
+		list->head = link->next;
+	}
+
+	if(link->next)
+	{
+		link->next->links[l].prev = link->prev;
 	}
+	else
+	{
+		list->tail = link->prev;
+	}
+
+	link->prev = NULL;
+	link->next = NULL;
 }
 
-static void
-_cntrl_refresh_value_abs(cntrl_t *cntrl, float val)
+// rt-thread, queues a voice at the tail of the lists matching its state
+static inline void
+_voice_enlist(dsp_t *dsp, voice_t *voice)
 {
-	if(cntrl->zone)
+	if(voice->state == VOICE_STATE_INACTIVE)
 	{
-		*cntrl->zone = val;
+		_voice_list_append(&dsp->idle, LIST_STATE, voice);
+	}
+	else
+	{
+		_voice_list_append(&dsp->busy, LIST_STATE, voice);
+		_voice_list_append(&dsp->channel[voice->hash.chn & 0x0f], LIST_CHANNEL,
+			voice);
 	}
 }
 
-static float
-_cntrl_get_value_abs(cntrl_t *cntrl)
+// rt-thread, must be called before changing a voice's state or channel
+static inline void
+_voice_unlist(dsp_t *dsp, voice_t *voice)
 {
-	if(cntrl->zone)
+	if(voice->state == VOICE_STATE_INACTIVE)
 	{
-		return *cntrl->zone;
+		_voice_list_remove(&dsp->idle, LIST_STATE, voice);
+	}
+	else
+	{
+		_voice_list_remove(&dsp->busy, LIST_STATE, voice);
+		_voice_list_remove(&dsp->channel[voice->hash.chn & 0x0f], LIST_CHANNEL,
+			voice);
 	}
+}
 
-	return 0.f;
+// rt-thread, (re)queues a voice at the tail of the lists matching its new state
+static inline void
+_voice_move(dsp_t *dsp, voice_t *voice, voice_state_t state)
+{
+	_voice_unlist(dsp, voice);
+	voice->state = state;
+	_voice_enlist(dsp, voice);
 }
 
-static float
-_cntrl_get_value_rel(cntrl_t *cntrl)
+static inline uint8_t *
+_voice_slot(dsp_t *dsp, const hash_t *hash)
 {
-	switch(cntrl->type)
-	{
-		case CNTRL_VERTICAL_BARGRAPH:
-		{
-			if(cntrl->zone)
-			{
-				return (*cntrl->zone - cntrl->vertical_bargraph.min) * cntrl->vertical_bargraph.ran_1;
-			}
-		} break;
-		case CNTRL_HORIZONTAL_BARGRAPH:
-		{
-			if(cntrl->zone)
-			{
-				return (*cntrl->zone - cntrl->horizontal_bargraph.min) * cntrl->horizontal_bargraph.ran_1;
-			}
-		} break;
+	return &dsp->active[hash->chn & 0x0f][hash->key & 0x7f];
+}
 
-		case CNTRL_NONE:
-			// fall-through
-		case CNTRL_BUTTON:
-			// fall-through
-		case CNTRL_CHECK_BUTTON:
-			// fall-through
-		case CNTRL_VERTICAL_SLIDER:
-			// fall-through
-		case CNTRL_HORIZONTAL_SLIDER:
-			// fall-through
-		case CNTRL_NUM_ENTRY:
-			// fall-through
-		case CNTRL_SOUND_FILE:
-			// fall-through
-		{
-			// nothing to do
-		} break;
+// indexes an active note by channel and key
+static inline void
+_voice_map(dsp_t *dsp, voice_t *voice)
+{
+	*_voice_slot(dsp, &voice->hash) = voice - dsp->voices + 1;
+}
+
+static inline void
+_voice_unmap(dsp_t *dsp, voice_t *voice)
+{
+	uint8_t *slot = _voice_slot(dsp, &voice->hash);
+
+	if(*slot == voice - dsp->voices + 1)
+	{
+		*slot = 0;
 	}
+}
 
-	return 0.f;
+static inline void
+_voice_unmap_all(dsp_t *dsp)
+{
+	memset(dsp->active, 0x0, sizeof(dsp->active));
 }
 
-static void
-_cntrl_refresh_value_rel(cntrl_t *cntrl, float val)
+// rt-thread, e.g. after voice states were copied over from another dsp
+static inline void
+_voice_lists_rebuild(dsp_t *dsp)
 {
-	switch(cntrl->type)
+	memset(&dsp->idle, 0x0, sizeof(dsp->idle));
+	memset(&dsp->busy, 0x0, sizeof(dsp->busy));
+	memset(dsp->channel, 0x0, sizeof(dsp->channel));
+	dsp->nlisted = dsp->nsynced;
+
+	for(uint32_t i = 0; i < dsp->nlisted; i++)
 	{
-		case CNTRL_NONE:
-		{
-			// do nothing
-		} break;
-		case CNTRL_BUTTON:
-		{
-			val = val > 0.5f
-				? 1.f
-				: 0.0;
+		_voice_enlist(dsp, &dsp->voices[i]);
+	}
+}
 
-			if(cntrl->zone)
-			{
-				*cntrl->zone = val;
-			}
-		} break;
-		case CNTRL_CHECK_BUTTON:
-		{
-			val = val > 0.5f
-				? 1.f
-				: 0.0;
+#if defined(_FAUST_HAS_INTERPRETER)
+#	define TIER_DISPATCH(DSP, LLVM, INTERPRETER) \
+	if((DSP)->tier == TIER_INTERPRETER) \
+	{ \
+		INTERPRETER; \
+	} \
+	else \
+	{ \
+		LLVM; \
+	}
+#else
+#	define TIER_DISPATCH(DSP, LLVM, INTERPRETER) \
+	{ \
+		(void)(DSP); \
+		LLVM; \
+	}
+#endif
 
-			if(cntrl->zone)
-			{
-				*cntrl->zone = val;
-			}
-		} break;
-		case CNTRL_VERTICAL_SLIDER:
-		{
-			val = val * cntrl->vertical_slider.ran
-				+ cntrl->vertical_slider.min;
+static inline void
+_voice_compute(dsp_t *dsp, voice_t *voice, int count,
+	FAUSTFLOAT **inputs, FAUSTFLOAT **outputs)
+{
+	TIER_DISPATCH(dsp,
+		computeCDSPInstance(voice->instance, count, inputs, outputs),
+		computeCInterpreterDSPInstance(voice->interpreter, count, inputs, outputs));
+}
 
-			if(cntrl->zone)
-			{
-				*cntrl->zone = val;
-			}
-		} break;
-		case CNTRL_HORIZONTAL_SLIDER:
-		{
-			val = val * cntrl->horizontal_slider.ran
-				+ cntrl->horizontal_slider.min;
+static inline int
+_voice_create(dsp_t *dsp, voice_t *voice)
+{
+#if defined(_FAUST_HAS_MEMORY_MANAGER)
+	// other threads may allocate from the same factory meanwhile, the per-thread
+	// delta is exact
+	const int64_t m0 = allocated;
+#endif
+	TIER_DISPATCH(dsp,
+		voice->instance = createCDSPInstance(dsp->factory->factory),
+		voice->interpreter = createCInterpreterDSPInstance(dsp->interpreter_factory));
+#if defined(_FAUST_HAS_MEMORY_MANAGER)
+	if(dsp->factory)
+	{
+		dsp->memory_voice = allocated - m0;
+	}
+#endif
 
-			if(cntrl->zone)
-			{
-				*cntrl->zone = val;
-			}
-		} break;
-		case CNTRL_NUM_ENTRY:
-		{
-			val = val * cntrl->num_entry.ran
-				+ cntrl->num_entry.min;
+	return voice->instance ? 0 : -1;
+}
 
-			if(cntrl->zone)
-			{
-				*cntrl->zone = val;
-			}
-		} break;
-		case CNTRL_SOUND_FILE:
-		{
-			//FIXME
-		} break;
+static inline int
+_voice_clone(dsp_t *dsp, voice_t *voice, voice_t *base_voice)
+{
+	TIER_DISPATCH(dsp,
+		voice->instance = cloneCDSPInstance(base_voice->instance),
+		voice->interpreter = cloneCInterpreterDSPInstance(base_voice->interpreter));
 
-		case CNTRL_HORIZONTAL_BARGRAPH:
-			// fall-through
-		case CNTRL_VERTICAL_BARGRAPH:
-		{
-			// nothing to do
-		} break;
-	}
+	return voice->instance ? 0 : -1;
 }
 
-static void
-_cntrl_refresh_attributes(cntrl_t *cntrl, float *min, float *max, float *step,
-	int32_t *type, char *label)
+static inline void
+_voice_init(dsp_t *dsp, voice_t *voice, int srate)
 {
-	*type = cntrl->type;
-	strncpy(label, cntrl->label, LABEL_SIZE - 1);
+	TIER_DISPATCH(dsp,
+		instanceInitCDSPInstance(voice->instance, srate),
+		instanceInitCInterpreterDSPInstance(voice->interpreter, srate));
+}
 
-	switch(cntrl->type)
-	{
-		case CNTRL_BUTTON:
-			// fall-through
-		case CNTRL_CHECK_BUTTON:
-		{
-			*min = 0.f;
-			*max = 1.f;
-			*step = 1.f;
-		} break;
+static inline void
+_voice_delete(dsp_t *dsp, voice_t *voice)
+{
+	TIER_DISPATCH(dsp,
+		instanceClearCDSPInstance(voice->instance);
+		deleteCDSPInstance(voice->instance),
+		instanceClearCInterpreterDSPInstance(voice->interpreter);
+		deleteCInterpreterDSPInstance(voice->interpreter));
 
-		case CNTRL_VERTICAL_SLIDER:
-		{
-			*min = cntrl->vertical_slider.min;
-			*max = cntrl->vertical_slider.max;
-			*step = cntrl->vertical_slider.step;
-		} break;
-		case CNTRL_HORIZONTAL_SLIDER:
-		{
-			*min = cntrl->horizontal_slider.min;
-			*max = cntrl->horizontal_slider.max;
-			*step = cntrl->horizontal_slider.step;
-		} break;
-		case CNTRL_NUM_ENTRY:
-		{
-			*min = cntrl->num_entry.min;
-			*max = cntrl->num_entry.max;
-			*step = cntrl->num_entry.step;
-		} break;
-		case CNTRL_HORIZONTAL_BARGRAPH:
-		{
-			*min = cntrl->horizontal_bargraph.min;
-			*max = cntrl->horizontal_bargraph.max;
-			*step = 1.f;
-		} break;
-		case CNTRL_VERTICAL_BARGRAPH:
-		{
-			*min = cntrl->vertical_bargraph.min;
-			*max = cntrl->vertical_bargraph.max;
-			*step = 1.f;
-		} break;
+	voice->instance = NULL;
+}
 
-		case CNTRL_NONE:
-			// fall-through
-		case CNTRL_SOUND_FILE:
-		{
-			// do nothing
-		} break;
-	}
+static inline void
+_voice_metadata(dsp_t *dsp, voice_t *voice, MetaGlue *glue)
+{
+	TIER_DISPATCH(dsp,
+		metadataCDSPInstance(voice->instance, glue),
+		metadataCInterpreterDSPInstance(voice->interpreter, glue));
 }
 
-static void
-_refresh_attributes(plughandle_t *handle, uint32_t idx)
+static inline void
+_voice_build_ui(dsp_t *dsp, voice_t *voice, UIGlue *glue)
 {
-	float min = 0.f;
-	float max = 0.f;
-	float step = 0.f;
-	int32_t type = CNTRL_NONE;
-	char label [LABEL_SIZE] = "";
+	TIER_DISPATCH(dsp,
+		buildUserInterfaceCDSPInstance(voice->instance, glue),
+		buildUserInterfaceCInterpreterDSPInstance(voice->interpreter, glue));
+}
 
-	dsp_t *dsp = handle->dsp[!handle->play];
+static inline void
+_voice_num_channels(dsp_t *dsp, voice_t *voice, uint32_t *nins,
+	uint32_t *nouts)
+{
+	TIER_DISPATCH(dsp,
+		*nins = getNumInputsCDSPInstance(voice->instance);
+		*nouts = getNumOutputsCDSPInstance(voice->instance),
+		*nins = getNumInputsCInterpreterDSPInstance(voice->interpreter);
+		*nouts = getNumOutputsCInterpreterDSPInstance(voice->interpreter));
+}
 
-	if(!dsp)
+static void
+_string_set(plughandle_t *handle, LV2_URID property, char *dst,
+	const char *src)
+{
+	props_impl_t *impl = _props_impl_get(&handle->props, property);
+
+	if(impl)
 	{
-		return;
+		snprintf(dst, impl->def->max_size, "%s", src);
+		impl->value.size = strlen(dst) + 1;
 	}
+}
 
-	VOICE_FOREACH(dsp, voice)
-	{
-		cntrl_t *cntrl = &voice->cntrls[idx];
+static char *
+_payload_append(char *dst, const char *src, size_t size)
+{
+	memcpy(dst, src, size);
+	dst[size - 1] = '\0';
 
-		if(cntrl->type == CNTRL_NONE)
-		{
-			continue;
-		}
+	return dst + size;
+}
 
-		_cntrl_refresh_attributes(cntrl, &min, &max, &step, &type, label);
-	}
+// parallel execution is flagged by a non-empty string
+static const char *
+_payload_parallel(bool parallel)
+{
+	return parallel ? PARALLEL_OPTION : "";
+}
 
+// non-rt thread, splits up "parallel\0options\0tuned\0code\0"
+static const char *
+_payload_parse(const char *payload, bool *parallel, const char **options,
+	const char **tuned)
+{
+	*parallel = payload[0] != '\0';
+	*options = payload + strlen(payload) + 1;
+	*tuned = *options + strlen(*options) + 1;
 
-	props_impl_t *impl = NULL;
+	return *tuned + strlen(*tuned) + 1;
+}
 
-	impl = _props_impl_get(&handle->props, handle->mephisto_controlMin[idx]);
-	if(impl)
+// rt-thread, hands over "parallel\0options\0tuned\0code\0" to the worker
+static void
+_submit_code(plughandle_t *handle)
+{
+	// already compiled on the state restore thread
+	if(handle->skip_submit)
 	{
-		_props_impl_set(&handle->props, impl, handle->forge.Float, sizeof(float), &min);
+		handle->skipped_submit = true;
+		return;
 	}
 
-	impl = _props_impl_get(&handle->props, handle->mephisto_controlMax[idx]);
-	if(impl)
+	const char *parallel = _payload_parallel(handle->state.parallel);
+	const size_t parallel_size = strlen(parallel) + 1;
+	const size_t options_size = strnlen(handle->state.compile_options,
+		OPTIONS_SIZE - 1) + 1;
+	const size_t tuned_size = strnlen(handle->state.tuned_options,
+		OPTIONS_SIZE - 1) + 1;
+	const size_t code_size = strnlen(handle->state.code, CODE_SIZE - 1) + 1;
+	const size_t size = parallel_size + options_size + tuned_size + code_size;
+
+	char *payload;
+	if( (payload = varchunk_write_request(handle->to_worker, size)) )
 	{
-		_props_impl_set(&handle->props, impl, handle->forge.Float, sizeof(float), &max);
-	}
+		payload = _payload_append(payload, parallel, parallel_size);
+		payload = _payload_append(payload, handle->state.compile_options,
+			options_size);
+		payload = _payload_append(payload, handle->state.tuned_options,
+			tuned_size);
+		_payload_append(payload, handle->state.code, code_size);
 
-	impl = _props_impl_get(&handle->props, handle->mephisto_controlStep[idx]);
-	if(impl)
-	{
-		_props_impl_set(&handle->props, impl, handle->forge.Float, sizeof(float), &step);
-	}
+		varchunk_write_advance(handle->to_worker, size);
 
-	impl = _props_impl_get(&handle->props, handle->mephisto_controlType[idx]);
-	if(impl)
-	{
-		_props_impl_set(&handle->props, impl, handle->forge.Int, sizeof(int32_t), &type);
+		const job_t job = {
+			.type = JOB_TYPE_INIT
+		};
+		handle->sched->schedule_work(handle->sched->handle, sizeof(job), &job);
 	}
-
-	impl = _props_impl_get(&handle->props, handle->mephisto_controlLabel[idx]);
-	if(impl)
+	else if(handle->log)
 	{
-		_props_impl_set(&handle->props, impl, handle->forge.String, strlen(label) + 1, label);
+		lv2_log_trace(&handle->logger, "[%s] ringbuffer overflow\n", __func__);
 	}
 }
 
 static void
-_refresh_value(plughandle_t *handle, uint32_t idx)
+_intercept_code(void *data, int64_t frames __attribute__((unused)),
+	props_impl_t *impl __attribute__((unused)))
 {
-	const bool off [2] = {
-		handle->play,
-		!handle->play
-	};
-
-	const float val = handle->state.control[idx];
+	plughandle_t *handle = data;
 
-	for(uint32_t d = 0; d < 2; d++)
+	// tuned options were benchmarked for the previous code and options, restored
+	// ones belong to the restored code, though
+	if(!handle->idling && handle->state.tuned_options[0])
 	{
-		dsp_t *dsp = handle->dsp[off[d]];
+		_string_set(handle, handle->mephisto_tunedOptions,
+			handle->state.tuned_options, "");
 
-		if(!dsp)
-		{
-			continue;
-		}
+		handle->dirty.tune = true;
+	}
 
-		VOICE_FOREACH(dsp, voice)
-		{
-			cntrl_t *cntrl = &voice->cntrls[idx];
+	_submit_code(handle);
+}
 
-			if(cntrl->type == CNTRL_NONE)
-			{
-				continue;
-			}
+static void
+_intercept_tuned_options(void *data, int64_t frames __attribute__((unused)),
+	props_impl_t *impl __attribute__((unused)))
+{
+	plughandle_t *handle = data;
 
-			_cntrl_refresh_value_rel(cntrl, val);
-		}
-	}
+	_submit_code(handle);
 }
 
+// rt-thread, payload is copied right behind the job
 static void
-_refresh_time_position(plughandle_t *handle)
+_schedule_payload(plughandle_t *handle, job_type_t type, const void *payload,
+	uint32_t size)
 {
-	const bool off [2] = {
-		handle->play,
-		!handle->play
-	};
+	_Alignas(job_t) uint8_t buf [sizeof(job_t) + JOB_PAYLOAD_MAX];
+	job_t *job = (job_t *)buf;
 
-	for(uint32_t d = 0; d < 2; d++)
+	if(size > JOB_PAYLOAD_MAX)
 	{
-		dsp_t *dsp = handle->dsp[off[d]];
+		return;
+	}
 
-		if(!dsp || !dsp->time_on)
-		{
-			continue;
-		}
+	job->type = type;
+	job->size = size;
+	memcpy(&buf[sizeof(job_t)], payload, size);
 
-		VOICE_FOREACH(dsp, voice)
-		{
-			_cntrl_refresh_value_abs(&voice->pos.bar_beat,
-				TIMELY_BAR_BEAT(&handle->timely));
-			_cntrl_refresh_value_abs(&voice->pos.bar,
-				TIMELY_BAR(&handle->timely));
-			_cntrl_refresh_value_abs(&voice->pos.beat_unit,
-				TIMELY_BEAT_UNIT(&handle->timely));
-			_cntrl_refresh_value_abs(&voice->pos.beats_per_bar,
-				TIMELY_BEATS_PER_BAR(&handle->timely));
-			_cntrl_refresh_value_abs(&voice->pos.beats_per_minute,
-				TIMELY_BEATS_PER_MINUTE(&handle->timely));
-			_cntrl_refresh_value_abs(&voice->pos.frame,
-				TIMELY_FRAME(&handle->timely));
-			_cntrl_refresh_value_abs(&voice->pos.frames_per_second,
-				TIMELY_FRAMES_PER_SECOND(&handle->timely));
-			_cntrl_refresh_value_abs(&voice->pos.speed,
-				TIMELY_SPEED(&handle->timely));
-		}
-	}
+	handle->sched->schedule_work(handle->sched->handle, sizeof(job_t) + size,
+		buf);
 }
 
 static void
-_intercept_xfade_duration(void *data, int64_t frames __attribute__((unused)),
+_intercept_tuning(void *data, int64_t frames __attribute__((unused)),
 	props_impl_t *impl __attribute__((unused)))
 {
 	plughandle_t *handle = data;
 
-	handle->xfade_max = handle->srate * handle->state.xfade_dur / 1000;
+	_schedule_payload(handle, JOB_TYPE_SCALA, handle->state.tuning,
+		strnlen(handle->state.tuning, TUNING_SIZE - 1) + 1);
 }
 
 static void
-_intercept_control(void *data, int64_t frames __attribute__((unused)),
-	props_impl_t *impl)
+_intercept_auto_tune(void *data, int64_t frames __attribute__((unused)),
+	props_impl_t *impl __attribute__((unused)))
 {
 	plughandle_t *handle = data;
-	const uint32_t idx = (float *)impl->value.body - handle->state.control;
-
-	_refresh_value(handle, idx);
-}
 
-static const props_def_t defs [MAX_NPROPS] = {
-	{
-		.property = MEPHISTO__code,
-		.offset = offsetof(plugstate_t, code),
-		.type = LV2_ATOM__String,
-		.event_cb = _intercept_code,
-		.max_size = CODE_SIZE
-	},
-	{
-		.property = MEPHISTO__error,
-		.access = LV2_PATCH__readable,
-		.offset = offsetof(plugstate_t, error),
-		.type = LV2_ATOM__String,
-		.max_size = ERROR_SIZE
-	},
-	{
-		.property = MEPHISTO__xfadeDuration,
-		.offset = offsetof(plugstate_t, xfade_dur),
-		.type = LV2_ATOM__Int,
-		.event_cb = _intercept_xfade_duration
-	},
-	{
-		.property = MEPHISTO__fontHeight,
-		.offset = offsetof(plugstate_t, font_height),
-		.type = LV2_ATOM__Int
-	},
+	if(handle->state.auto_tune)
 	{
-		.property = MEPHISTO__timestamp,
-		.access = LV2_PATCH__readable,
-		.offset = offsetof(plugstate_t, timestamp),
-		.type = LV2_ATOM__Long
-	},
-	CONTROL(1),
-	CONTROL(2),
-	CONTROL(3),
-	CONTROL(4),
-	CONTROL(5),
-	CONTROL(6),
-	CONTROL(7),
-	CONTROL(1),
-	CONTROL(9),
-	CONTROL(10),
-	CONTROL(11),
-	CONTROL(12),
-	CONTROL(13),
-	CONTROL(14),
-	CONTROL(15),
-	CONTROL(16)
-};
+		const job_t job = {
+			.type = JOB_TYPE_TUNE
+		};
 
-static inline void
-_play(plughandle_t *handle, int64_t from, int64_t to)
-{
-	const uint32_t nsamples = to - from;
+		handle->sched->schedule_work(handle->sched->handle, sizeof(job), &job);
+	}
+}
 
-	FAUSTFLOAT *audio_in [32];
-	FAUSTFLOAT *audio_out [32];
+static void
+_intercept_voice_threads(void *data, int64_t frames __attribute__((unused)),
+	props_impl_t *impl __attribute__((unused)))
+{
+	plughandle_t *handle = data;
+	int32_t *voice_threads = &handle->state.voice_threads;
 
-	// libFAUST does not check for valid audio buffer pointers,
-	// so we must provide a plethora (32) of them in case the user makes a patch
-	// with more than 2 ins and outs
-	for(uint32_t i = 0; i < 32; i++)
+	// report back the number of threads actually used
+	if(*voice_threads < 1)
 	{
-		const uint32_t idx = i % handle->nchannel;
-
-		audio_in[i] = handle->faudio_in[idx];
-		audio_out[i] = handle->faudio_out[idx];
+		*voice_threads = 1;
+		handle->dirty.voice_threads = true;
 	}
-
-	// fill audio in, clear audio out
-	for(uint32_t n = 0; n < handle->nchannel; n++)
+	else if(*voice_threads > POOL_THREADS_MAX)
 	{
-		for(uint32_t i = 0; i < nsamples; i++)
-		{
-			audio_in[n][i] = handle->audio_in[n][from + i];
-			handle->audio_out[n][from + i] = 0.f;
-		}
+		*voice_threads = POOL_THREADS_MAX;
+		handle->dirty.voice_threads = true;
 	}
 
-	const bool off [2] = {
-		handle->play,
-		!handle->play
+	const job_t job = {
+		.type = JOB_TYPE_POOL,
+		.nlanes = *voice_threads
 	};
 
-	for(uint32_t d = 0; d < 2; d++)
-	{
-		dsp_t *dsp = handle->dsp[off[d]];
-
-		if(!dsp)
-		{
-			continue;
-		}
+	handle->sched->schedule_work(handle->sched->handle, sizeof(job), &job);
+}
 
-		float gain = 1.f;
+static void
+_cntrl_refresh_value_abs(cntrl_t *cntrl, float val)
+{
+	if(cntrl->zone)
+	{
+		*cntrl->zone = val;
+	}
+}
 
-		if(handle->xfade_cur > 0)
-		{
-			const float t = 2.f * handle->xfade_cur / handle->xfade_max - 1.f;
+static float
+_cntrl_get_value_abs(cntrl_t *cntrl)
+{
+	if(cntrl->zone)
+	{
+		return *cntrl->zone;
+	}
+
+	return 0.f;
+}
 
-			if(d == 0) // fade-out
+static float
+_cntrl_get_value_rel(cntrl_t *cntrl)
+{
+	switch(cntrl->type)
+	{
+		case CNTRL_VERTICAL_BARGRAPH:
+		{
+			if(cntrl->zone)
 			{
-				gain = sqrtf(0.5f * (1.f + t) );
+				return (*cntrl->zone - cntrl->vertical_bargraph.min) * cntrl->vertical_bargraph.ran_1;
 			}
-			else // fade-in
+		} break;
+		case CNTRL_HORIZONTAL_BARGRAPH:
+		{
+			if(cntrl->zone)
 			{
-				gain = sqrtf(0.5f * (1.f - t) );
+				return (*cntrl->zone - cntrl->horizontal_bargraph.min) * cntrl->horizontal_bargraph.ran_1;
 			}
-		}
-		else
+		} break;
+
+		case CNTRL_NONE:
+			// fall-through
+		case CNTRL_BUTTON:
+			// fall-through
+		case CNTRL_CHECK_BUTTON:
+			// fall-through
+		case CNTRL_VERTICAL_SLIDER:
+			// fall-through
+		case CNTRL_HORIZONTAL_SLIDER:
+			// fall-through
+		case CNTRL_NUM_ENTRY:
+			// fall-through
+		case CNTRL_SOUND_FILE:
+			// fall-through
 		{
-			if(d == 1)
+			// nothing to do
+		} break;
+	}
+
+	return 0.f;
+}
+
+static void
+_cntrl_refresh_value_rel(cntrl_t *cntrl, float val)
+{
+	switch(cntrl->type)
+	{
+		case CNTRL_NONE:
+		{
+			// do nothing
+		} break;
+		case CNTRL_BUTTON:
+		{
+			val = val > 0.5f
+				? 1.f
+				: 0.0;
+
+			if(cntrl->zone)
 			{
-				continue; // skip this
+				*cntrl->zone = val;
 			}
-		}
-
-		VOICE_FOREACH(dsp, voice)
+		} break;
+		case CNTRL_CHECK_BUTTON:
 		{
+			val = val > 0.5f
+				? 1.f
+				: 0.0;
+
+			if(cntrl->zone)
 			{
-				if(voice->retrigger)
-				{
-					_cntrl_refresh_value_abs(&voice->gate, 0.f);
-					computeCDSPInstance(voice->instance, 1, audio_in, audio_out);
-					_cntrl_refresh_value_abs(&voice->gate, 1.f);
+				*cntrl->zone = val;
+			}
+		} break;
+		case CNTRL_VERTICAL_SLIDER:
+		{
+			val = val * cntrl->vertical_slider.ran
+				+ cntrl->vertical_slider.min;
 
-					voice->retrigger = false;
-				}
+			if(cntrl->zone)
+			{
+				*cntrl->zone = val;
+			}
+		} break;
+		case CNTRL_HORIZONTAL_SLIDER:
+		{
+			val = val * cntrl->horizontal_slider.ran
+				+ cntrl->horizontal_slider.min;
 
-				computeCDSPInstance(voice->instance, nsamples, audio_in, audio_out);
+			if(cntrl->zone)
+			{
+				*cntrl->zone = val;
+			}
+		} break;
+		case CNTRL_NUM_ENTRY:
+		{
+			val = val * cntrl->num_entry.ran
+				+ cntrl->num_entry.min;
 
-				// add to master out
-				for(uint32_t n = 0; n < handle->nchannel; n++)
-				{
-					for(uint32_t i = 0; i < nsamples; i++)
-					{
-						handle->audio_out[n][from + i] += gain * audio_out[n][i];
-					}
-				}
+			if(cntrl->zone)
+			{
+				*cntrl->zone = val;
 			}
-		}
+		} break;
+		case CNTRL_SOUND_FILE:
+		{
+			//FIXME
+		} break;
+
+		case CNTRL_HORIZONTAL_BARGRAPH:
+			// fall-through
+		case CNTRL_VERTICAL_BARGRAPH:
+		{
+			// nothing to do
+		} break;
 	}
+}
 
-	if(handle->xfade_cur > 0)
+static void
+_cntrl_refresh_attributes(cntrl_t *cntrl, float *min, float *max, float *step,
+	int32_t *type, char *label)
+{
+	*type = cntrl->type;
+	strncpy(label, cntrl->label, LABEL_SIZE - 1);
+
+	switch(cntrl->type)
 	{
-		if(nsamples >= handle->xfade_cur)
+		case CNTRL_BUTTON:
+			// fall-through
+		case CNTRL_CHECK_BUTTON:
 		{
-			handle->xfade_cur = 0;
+			*min = 0.f;
+			*max = 1.f;
+			*step = 1.f;
+		} break;
 
-			// switch dsps
-			handle->play = !handle->play;
-		}
-		else
+		case CNTRL_VERTICAL_SLIDER:
 		{
-			handle->xfade_cur -= nsamples;
-		}
+			*min = cntrl->vertical_slider.min;
+			*max = cntrl->vertical_slider.max;
+			*step = cntrl->vertical_slider.step;
+		} break;
+		case CNTRL_HORIZONTAL_SLIDER:
+		{
+			*min = cntrl->horizontal_slider.min;
+			*max = cntrl->horizontal_slider.max;
+			*step = cntrl->horizontal_slider.step;
+		} break;
+		case CNTRL_NUM_ENTRY:
+		{
+			*min = cntrl->num_entry.min;
+			*max = cntrl->num_entry.max;
+			*step = cntrl->num_entry.step;
+		} break;
+		case CNTRL_HORIZONTAL_BARGRAPH:
+		{
+			*min = cntrl->horizontal_bargraph.min;
+			*max = cntrl->horizontal_bargraph.max;
+			*step = 1.f;
+		} break;
+		case CNTRL_VERTICAL_BARGRAPH:
+		{
+			*min = cntrl->vertical_bargraph.min;
+			*max = cntrl->vertical_bargraph.max;
+			*step = 1.f;
+		} break;
+
+		case CNTRL_NONE:
+			// fall-through
+		case CNTRL_SOUND_FILE:
+		{
+			// do nothing
+		} break;
 	}
 }
 
 static void
-_timely_cb(timely_t *timely __attribute__((unused)),
-	int64_t frames __attribute__((unused)), LV2_URID type __attribute__((unused)),
-	void *data __attribute__((unused)))
+_refresh_attributes(plughandle_t *handle, uint32_t idx)
 {
-	// nothing to do
-}
+	float min = 0.f;
+	float max = 0.f;
+	float step = 0.f;
+	int32_t type = CNTRL_NONE;
+	char label [LABEL_SIZE] = "";
 
-static int
-_dsp_dir(char *buf, size_t len)
-{
-	FILE *fin = popen("faust -dspdir", "r");
-	if(!fin)
+	dsp_t *dsp = handle->dsp[!handle->play];
+
+	if(!dsp)
 	{
-		return -1;
+		return;
 	}
 
-	const size_t sz = fread(buf, 1, len, fin);
-	pclose(fin);
-
-	if(sz == 0)
+	VOICE_FOREACH(dsp, voice)
 	{
-		return 1;
-	}
+		cntrl_t *cntrl = &voice->cntrls[idx];
 
-	buf[sz] = '\0';
+		if(cntrl->type == CNTRL_NONE)
+		{
+			continue;
+		}
 
-	char *esc = strpbrk(buf, "\n\r");
-	if(esc)
-	{
-		*esc = '\0';
+		_cntrl_refresh_attributes(cntrl, &min, &max, &step, &type, label);
 	}
 
-	return 0;
-}
 
-static LV2_Handle
-instantiate(const LV2_Descriptor* descriptor, double rate,
-	const char *bundle_path, const LV2_Feature *const *features)
-{
-	plughandle_t *handle = calloc(1, sizeof(plughandle_t));
-	if(!handle)
+	props_impl_t *impl = NULL;
+
+	impl = _props_impl_get(&handle->props, handle->mephisto_controlMin[idx]);
+	if(impl)
 	{
-		return NULL;
+		_props_impl_set(&handle->props, impl, handle->forge.Float, sizeof(float), &min);
 	}
-	mlock(handle, sizeof(plughandle_t));
 
-	handle->nchannel = 1;
-	if(  !strcmp(descriptor->URI, MEPHISTO__audio_2x2)
-		|| !strcmp(descriptor->URI, MEPHISTO__cv_2x2) )
+	impl = _props_impl_get(&handle->props, handle->mephisto_controlMax[idx]);
+	if(impl)
 	{
-		handle->nchannel = 2;
+		_props_impl_set(&handle->props, impl, handle->forge.Float, sizeof(float), &max);
 	}
-	else if(!strcmp(descriptor->URI, MEPHISTO__audio_4x4)
-		|| !strcmp(descriptor->URI, MEPHISTO__cv_4x4) )
+
+	impl = _props_impl_get(&handle->props, handle->mephisto_controlStep[idx]);
+	if(impl)
 	{
-		handle->nchannel = 4;
+		_props_impl_set(&handle->props, impl, handle->forge.Float, sizeof(float), &step);
 	}
-	else if(!strcmp(descriptor->URI, MEPHISTO__audio_8x8)
-		|| !strcmp(descriptor->URI, MEPHISTO__cv_8x8) )
+
+	impl = _props_impl_get(&handle->props, handle->mephisto_controlType[idx]);
+	if(impl)
 	{
-		handle->nchannel = 8;
+		_props_impl_set(&handle->props, impl, handle->forge.Int, sizeof(int32_t), &type);
 	}
 
-	strncpy(handle->bundle_path, bundle_path, sizeof(handle->bundle_path) - 1);
+	impl = _props_impl_get(&handle->props, handle->mephisto_controlLabel[idx]);
+	if(impl)
+	{
+		_props_impl_set(&handle->props, impl, handle->forge.String, strlen(label) + 1, label);
+	}
+}
 
-	LV2_Options_Option *opts = NULL;
-	for(unsigned i=0; features[i]; i++)
+// rt-thread, takes over a held note of the previous dsp
+static inline void
+_voice_carry(dsp_t *dsp, voice_t *voice)
+{
+	for( ; dsp->icarry < dsp->ncarry; dsp->icarry++)
 	{
-		if(!strcmp(features[i]->URI, LV2_URID__map))
-		{
-			handle->map = features[i]->data;
-		}
-		else if(!strcmp(features[i]->URI, LV2_WORKER__schedule))
-		{
-			handle->sched= features[i]->data;
-		}
-		else if(!strcmp(features[i]->URI, LV2_LOG__log))
+		const carry_t *carry = &dsp->carry[dsp->icarry];
+
+		if(carry->state == VOICE_STATE_INACTIVE)
 		{
-			handle->log = features[i]->data;
+			continue; // released meanwhile
 		}
-		else if(!strcmp(features[i]->URI, LV2_OPTIONS__options))
+
+		_cntrl_refresh_value_abs(&voice->gate, carry->gate);
+		_cntrl_refresh_value_abs(&voice->gain, carry->gain);
+		_cntrl_refresh_value_abs(&voice->freq, carry->freq);
+		_cntrl_refresh_value_abs(&voice->pressure, carry->pressure);
+		_cntrl_refresh_value_abs(&voice->timbre, carry->timbre);
+		_cntrl_refresh_value_abs(&voice->d_freq, carry->d_freq);
+		_cntrl_refresh_value_abs(&voice->d_pressure, carry->d_pressure);
+		_cntrl_refresh_value_abs(&voice->d_timbre, carry->d_timbre);
+
+		voice->state = carry->state;
+		voice->hash = carry->hash;
+		voice->peak = FLT_MAX;
+
+		if(voice->state == VOICE_STATE_ACTIVE)
 		{
-			opts = features[i]->data;
+			_voice_map(dsp, voice);
 		}
-	}
 
-	if(!handle->map)
-	{
-		fprintf(stderr,
-			"%s: Host does not support urid:map\n", descriptor->URI);
-		free(handle);
-		return NULL;
+		dsp->icarry++;
+		break;
 	}
+}
 
-	if(!handle->sched)
-	{
-		fprintf(stderr,
-			"%s: Host does not support work:sched\n", descriptor->URI);
-		free(handle);
-		return NULL;
-	}
+// rt-thread, applies current control values to voices lazily published since,
+// once per cycle
+static void
+_voice_sync(plughandle_t *handle, dsp_t *dsp)
+{
+	const uint32_t nready = _voice_ready(dsp);
 
-	if(_dsp_dir(handle->dsp_dir, sizeof(handle->dsp_dir)) != 0)
+	// lazily published voices are inactive, unless there are notes left over
+	for( ; dsp->nlisted < nready; dsp->nlisted++)
 	{
-		fprintf(stderr,
-			"%s: failed to get FAUST DSP directory\n", descriptor->URI);
-		free(handle);
-		return NULL;
+		voice_t *voice = &dsp->voices[dsp->nlisted];
+
+		_voice_carry(dsp, voice);
+		_voice_enlist(dsp, voice);
 	}
 
-	if(handle->log)
+	for( ; dsp->nsynced < nready; dsp->nsynced++)
 	{
-		lv2_log_logger_init(&handle->logger, handle->map, handle->log);
+		voice_t *voice = &dsp->voices[dsp->nsynced];
+
+		for(uint32_t idx = 0; idx < NCONTROLS; idx++)
+		{
+			cntrl_t *cntrl = &voice->cntrls[idx];
+
+			if(cntrl->type == CNTRL_NONE)
+			{
+				continue;
+			}
+
+			_cntrl_refresh_value_rel(cntrl, handle->state.control[idx]);
+		}
 	}
+}
 
-	lv2_atom_forge_init(&handle->forge, handle->map);
+static void
+_refresh_value(plughandle_t *handle, uint32_t idx)
+{
+	const bool off [2] = {
+		handle->play,
+		!handle->play
+	};
 
-	handle->midi_MidiEvent = handle->map->map(handle->map->handle,
-		LV2_MIDI__MidiEvent);
-	const LV2_URID bufsz_maxBlockLength = handle->map->map(handle->map->handle,
-		LV2_BUF_SIZE__maxBlockLength);
+	const float val = handle->state.control[idx];
 
-	int32_t max_block_length = 0;
-	for(LV2_Options_Option *opt = opts;
-		(opt->key != 0) && (opt->value != NULL);
-		opt++)
+	for(uint32_t d = 0; d < 2; d++)
 	{
-		if(  (opt->key == bufsz_maxBlockLength)
-			&& (opt->size == sizeof(int32_t))
-			&& (opt->type == handle->forge.Int) )
+		dsp_t *dsp = handle->dsp[off[d]];
+
+		if(!dsp)
 		{
-			max_block_length = *(const int32_t *)opt->value;
+			continue;
+		}
 
-			break;
+		VOICE_FOREACH(dsp, voice)
+		{
+			cntrl_t *cntrl = &voice->cntrls[idx];
+
+			if(cntrl->type == CNTRL_NONE)
+			{
+				continue;
+			}
+
+			_cntrl_refresh_value_rel(cntrl, val);
 		}
 	}
+}
 
-	if(max_block_length == 0)
-	{
-		fprintf(stderr,
-			"%s: Host does not provide bufsz:maxBlockLength\n", descriptor->URI);
-		free(handle);
-		return NULL;
-	}
+static void
+_refresh_time_position(plughandle_t *handle)
+{
+	const bool off [2] = {
+		handle->play,
+		!handle->play
+	};
 
-	const size_t buflen = sizeof(FAUSTFLOAT) * max_block_length;
-	for(uint32_t n = 0; n < handle->nchannel; n++)
+	for(uint32_t d = 0; d < 2; d++)
 	{
-		handle->faudio_in[n] = malloc(buflen);
-		handle->faudio_out[n] = malloc(buflen);
+		dsp_t *dsp = handle->dsp[off[d]];
 
-		if(!handle->faudio_in[n] || !handle->faudio_out[n])
+		if(!dsp || !dsp->time_on)
 		{
-			for(n = 0; n < handle->nchannel; n++)
-			{
-				free(handle->faudio_in[n]);
-				free(handle->faudio_out[n]);
-			}
+			continue;
+		}
 
-			free(handle);
-			return NULL;
+		VOICE_FOREACH(dsp, voice)
+		{
+			_cntrl_refresh_value_abs(&voice->pos.bar_beat,
+				TIMELY_BAR_BEAT(&handle->timely));
+			_cntrl_refresh_value_abs(&voice->pos.bar,
+				TIMELY_BAR(&handle->timely));
+			_cntrl_refresh_value_abs(&voice->pos.beat_unit,
+				TIMELY_BEAT_UNIT(&handle->timely));
+			_cntrl_refresh_value_abs(&voice->pos.beats_per_bar,
+				TIMELY_BEATS_PER_BAR(&handle->timely));
+			_cntrl_refresh_value_abs(&voice->pos.beats_per_minute,
+				TIMELY_BEATS_PER_MINUTE(&handle->timely));
+			_cntrl_refresh_value_abs(&voice->pos.frame,
+				TIMELY_FRAME(&handle->timely));
+			_cntrl_refresh_value_abs(&voice->pos.frames_per_second,
+				TIMELY_FRAMES_PER_SECOND(&handle->timely));
+			_cntrl_refresh_value_abs(&voice->pos.speed,
+				TIMELY_SPEED(&handle->timely));
 		}
 	}
+}
 
-	if(!props_init(&handle->props, descriptor->URI,
-		defs, MAX_NPROPS, &handle->state, &handle->stash,
-		handle->map, handle))
+static void
+_intercept_xfade_duration(void *data, int64_t frames __attribute__((unused)),
+	props_impl_t *impl __attribute__((unused)))
+{
+	plughandle_t *handle = data;
+
+	handle->xfade_max = handle->srate * handle->state.xfade_dur / 1000;
+}
+
+static void
+_intercept_silence_threshold(void *data,
+	int64_t frames __attribute__((unused)),
+	props_impl_t *impl __attribute__((unused)))
+{
+	plughandle_t *handle = data;
+
+	handle->silence_level = powf(10.f, handle->state.silence_threshold / 20.f);
+}
+
+static void
+_intercept_silence_blocks(void *data, int64_t frames __attribute__((unused)),
+	props_impl_t *impl __attribute__((unused)))
+{
+	plughandle_t *handle = data;
+	int32_t *silence_blocks = &handle->state.silence_blocks;
+
+	// report back the number actually used
+	if(*silence_blocks < 1)
 	{
-		fprintf(stderr, "failed to initialize property structure\n");
-		free(handle);
-		return NULL;
+		*silence_blocks = 1;
+		handle->dirty.silence_blocks = true;
+	}
+	else if(*silence_blocks > SILENCE_BLOCKS_MAX)
+	{
+		*silence_blocks = SILENCE_BLOCKS_MAX;
+		handle->dirty.silence_blocks = true;
 	}
+}
 
-	handle->mephisto_error = props_map(&handle->props, MEPHISTO__error);
-	handle->mephisto_timestamp = props_map(&handle->props, MEPHISTO__timestamp);
+static void
+_intercept_quantization(void *data, int64_t frames __attribute__((unused)),
+	props_impl_t *impl __attribute__((unused)))
+{
+	plughandle_t *handle = data;
+	int32_t *quantization = &handle->state.quantization;
 
-	handle->mephisto_control[0] = props_map(&handle->props, MEPHISTO__control_1);
-	handle->mephisto_control[1] = props_map(&handle->props, MEPHISTO__control_2);
-	handle->mephisto_control[2] = props_map(&handle->props, MEPHISTO__control_3);
-	handle->mephisto_control[3] = props_map(&handle->props, MEPHISTO__control_4);
-	handle->mephisto_control[4] = props_map(&handle->props, MEPHISTO__control_5);
-	handle->mephisto_control[5] = props_map(&handle->props, MEPHISTO__control_6);
-	handle->mephisto_control[6] = props_map(&handle->props, MEPHISTO__control_7);
-	handle->mephisto_control[7] = props_map(&handle->props, MEPHISTO__control_8);
-	handle->mephisto_control[8] = props_map(&handle->props, MEPHISTO__control_9);
-	handle->mephisto_control[9] = props_map(&handle->props, MEPHISTO__control_10);
-	handle->mephisto_control[10] = props_map(&handle->props, MEPHISTO__control_11);
-	handle->mephisto_control[11] = props_map(&handle->props, MEPHISTO__control_12);
-	handle->mephisto_control[12] = props_map(&handle->props, MEPHISTO__control_13);
-	handle->mephisto_control[13] = props_map(&handle->props, MEPHISTO__control_14);
-	handle->mephisto_control[14] = props_map(&handle->props, MEPHISTO__control_15);
-	handle->mephisto_control[15] = props_map(&handle->props, MEPHISTO__control_16);
+	// report back the grid actually used
+	if(*quantization < 0)
+	{
+		*quantization = 0;
+		handle->dirty.quantization = true;
+	}
+	else if(*quantization > (int32_t)handle->max_block_length)
+	{
+		*quantization = handle->max_block_length;
+		handle->dirty.quantization = true;
+	}
+}
 
-	handle->mephisto_controlMin[0] = props_map(&handle->props, MEPHISTO__controlMin_1);
-	handle->mephisto_controlMin[1] = props_map(&handle->props, MEPHISTO__controlMin_2);
-	handle->mephisto_controlMin[2] = props_map(&handle->props, MEPHISTO__controlMin_3);
-	handle->mephisto_controlMin[3] = props_map(&handle->props, MEPHISTO__controlMin_4);
-	handle->mephisto_controlMin[4] = props_map(&handle->props, MEPHISTO__controlMin_5);
-	handle->mephisto_controlMin[5] = props_map(&handle->props, MEPHISTO__controlMin_6);
-	handle->mephisto_controlMin[6] = props_map(&handle->props, MEPHISTO__controlMin_7);
-	handle->mephisto_controlMin[7] = props_map(&handle->props, MEPHISTO__controlMin_8);
-	handle->mephisto_controlMin[8] = props_map(&handle->props, MEPHISTO__controlMin_9);
-	handle->mephisto_controlMin[9] = props_map(&handle->props, MEPHISTO__controlMin_10);
-	handle->mephisto_controlMin[10] = props_map(&handle->props, MEPHISTO__controlMin_11);
-	handle->mephisto_controlMin[11] = props_map(&handle->props, MEPHISTO__controlMin_12);
-	handle->mephisto_controlMin[12] = props_map(&handle->props, MEPHISTO__controlMin_13);
-	handle->mephisto_controlMin[13] = props_map(&handle->props, MEPHISTO__controlMin_14);
-	handle->mephisto_controlMin[14] = props_map(&handle->props, MEPHISTO__controlMin_15);
-	handle->mephisto_controlMin[15] = props_map(&handle->props, MEPHISTO__controlMin_16);
+// host blocks made up of whole internal blocks need no fifo, thus no latency
+static void
+_fifo_reset(plughandle_t *handle)
+{
+	const uint32_t block_length = handle->state.block_length;
+	const bool aligned = handle->fixed_block_length
+		&& (block_length > 0)
+		&& (handle->nominal_block_length > 0)
+		&& (handle->nominal_block_length % block_length == 0);
 
-	handle->mephisto_controlMax[0] = props_map(&handle->props, MEPHISTO__controlMax_1);
-	handle->mephisto_controlMax[1] = props_map(&handle->props, MEPHISTO__controlMax_2);
-	handle->mephisto_controlMax[2] = props_map(&handle->props, MEPHISTO__controlMax_3);
-	handle->mephisto_controlMax[3] = props_map(&handle->props, MEPHISTO__controlMax_4);
-	handle->mephisto_controlMax[4] = props_map(&handle->props, MEPHISTO__controlMax_5);
-	handle->mephisto_controlMax[5] = props_map(&handle->props, MEPHISTO__controlMax_6);
-	handle->mephisto_controlMax[6] = props_map(&handle->props, MEPHISTO__controlMax_7);
-	handle->mephisto_controlMax[7] = props_map(&handle->props, MEPHISTO__controlMax_8);
-	handle->mephisto_controlMax[8] = props_map(&handle->props, MEPHISTO__controlMax_9);
-	handle->mephisto_controlMax[9] = props_map(&handle->props, MEPHISTO__controlMax_10);
-	handle->mephisto_controlMax[10] = props_map(&handle->props, MEPHISTO__controlMax_11);
-	handle->mephisto_controlMax[11] = props_map(&handle->props, MEPHISTO__controlMax_12);
-	handle->mephisto_controlMax[12] = props_map(&handle->props, MEPHISTO__controlMax_13);
-	handle->mephisto_controlMax[13] = props_map(&handle->props, MEPHISTO__controlMax_14);
-	handle->mephisto_controlMax[14] = props_map(&handle->props, MEPHISTO__controlMax_15);
-	handle->mephisto_controlMax[15] = props_map(&handle->props, MEPHISTO__controlMax_16);
+	handle->fifo_latency = (block_length && !aligned)
+		? block_length
+		: 0;
+	handle->fifo_pos = 0;
 
-	handle->mephisto_controlStep[0] = props_map(&handle->props, MEPHISTO__controlStep_1);
-	handle->mephisto_controlStep[1] = props_map(&handle->props, MEPHISTO__controlStep_2);
-	handle->mephisto_controlStep[2] = props_map(&handle->props, MEPHISTO__controlStep_3);
-	handle->mephisto_controlStep[3] = props_map(&handle->props, MEPHISTO__controlStep_4);
-	handle->mephisto_controlStep[4] = props_map(&handle->props, MEPHISTO__controlStep_5);
-	handle->mephisto_controlStep[5] = props_map(&handle->props, MEPHISTO__controlStep_6);
-	handle->mephisto_controlStep[6] = props_map(&handle->props, MEPHISTO__controlStep_7);
-	handle->mephisto_controlStep[7] = props_map(&handle->props, MEPHISTO__controlStep_8);
-	handle->mephisto_controlStep[8] = props_map(&handle->props, MEPHISTO__controlStep_9);
-	handle->mephisto_controlStep[9] = props_map(&handle->props, MEPHISTO__controlStep_10);
-	handle->mephisto_controlStep[10] = props_map(&handle->props, MEPHISTO__controlStep_11);
+	for(uint32_t n = 0; n < handle->nchannel; n++)
+	{
+		handle->kernel.clear(handle->fifo_out[n], BLOCK_LENGTH_MAX);
+	}
+}
+
+static void
+_intercept_block_length(void *data, int64_t frames __attribute__((unused)),
+	props_impl_t *impl __attribute__((unused)))
+{
+	plughandle_t *handle = data;
+	int32_t *block_length = &handle->state.block_length;
+
+	// report back the block length actually used
+	if(*block_length < 0)
+	{
+		*block_length = 0;
+		handle->dirty.block_length = true;
+	}
+	else if(*block_length > BLOCK_LENGTH_MAX)
+	{
+		*block_length = BLOCK_LENGTH_MAX;
+		handle->dirty.block_length = true;
+	}
+
+	_fifo_reset(handle);
+}
+
+static void
+_intercept_control(void *data, int64_t frames __attribute__((unused)),
+	props_impl_t *impl)
+{
+	plughandle_t *handle = data;
+	const uint32_t idx = (float *)impl->value.body - handle->state.control;
+
+	_refresh_value(handle, idx);
+}
+
+static const props_def_t defs [MAX_NPROPS] = {
+	{
+		.property = MEPHISTO__code,
+		.offset = offsetof(plugstate_t, code),
+		.type = LV2_ATOM__String,
+		.event_cb = _intercept_code,
+		.max_size = CODE_SIZE
+	},
+	{
+		.property = MEPHISTO__error,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, error),
+		.type = LV2_ATOM__String,
+		.max_size = ERROR_SIZE
+	},
+	{
+		.property = MEPHISTO__xfadeDuration,
+		.offset = offsetof(plugstate_t, xfade_dur),
+		.type = LV2_ATOM__Int,
+		.event_cb = _intercept_xfade_duration
+	},
+	{
+		.property = MEPHISTO__fontHeight,
+		.offset = offsetof(plugstate_t, font_height),
+		.type = LV2_ATOM__Int
+	},
+	{
+		.property = MEPHISTO__timestamp,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, timestamp),
+		.type = LV2_ATOM__Long
+	},
+	{
+		.property = MEPHISTO__compileQueue,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, compile_queue),
+		.type = LV2_ATOM__Int
+	},
+	{
+		.property = MEPHISTO__tiered,
+		.offset = offsetof(plugstate_t, tiered),
+		.type = LV2_ATOM__Bool
+	},
+	{
+		.property = MEPHISTO__compileOptions,
+		.offset = offsetof(plugstate_t, compile_options),
+		.type = LV2_ATOM__String,
+		.event_cb = _intercept_code,
+		.max_size = OPTIONS_SIZE
+	},
+	{
+		.property = MEPHISTO__autoTune,
+		.offset = offsetof(plugstate_t, auto_tune),
+		.type = LV2_ATOM__Bool,
+		.event_cb = _intercept_auto_tune
+	},
+	{
+		.property = MEPHISTO__tunedOptions,
+		.offset = offsetof(plugstate_t, tuned_options),
+		.type = LV2_ATOM__String,
+		.event_cb = _intercept_tuned_options,
+		.max_size = OPTIONS_SIZE
+	},
+	{
+		.property = MEPHISTO__target,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, target),
+		.type = LV2_ATOM__String,
+		.max_size = TARGET_SIZE
+	},
+	{
+		.property = MEPHISTO__compileTimeFactory,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, time_factory),
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = MEPHISTO__compileTimeInstance,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, time_instance),
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = MEPHISTO__compileTimeInit,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, time_init),
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = MEPHISTO__compileTimeClone,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, time_clone),
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = MEPHISTO__compileTimeUi,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, time_ui),
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = MEPHISTO__memoryFactory,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, memory_factory),
+		.type = LV2_ATOM__Long
+	},
+	{
+		.property = MEPHISTO__memoryInstances,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, memory_instances),
+		.type = LV2_ATOM__Long
+	},
+	{
+		.property = MEPHISTO__silenceThreshold,
+		.offset = offsetof(plugstate_t, silence_threshold),
+		.type = LV2_ATOM__Float,
+		.event_cb = _intercept_silence_threshold
+	},
+	{
+		.property = MEPHISTO__silenceBlocks,
+		.offset = offsetof(plugstate_t, silence_blocks),
+		.type = LV2_ATOM__Int,
+		.event_cb = _intercept_silence_blocks
+	},
+	{
+		.property = MEPHISTO__parkedVoices,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, parked_voices),
+		.type = LV2_ATOM__Int
+	},
+	{
+		.property = MEPHISTO__quantization,
+		.offset = offsetof(plugstate_t, quantization),
+		.type = LV2_ATOM__Int,
+		.event_cb = _intercept_quantization
+	},
+	{
+		.property = MEPHISTO__blockLength,
+		.offset = offsetof(plugstate_t, block_length),
+		.type = LV2_ATOM__Int,
+		.event_cb = _intercept_block_length
+	},
+	{
+		.property = MEPHISTO__voiceThreads,
+		.offset = offsetof(plugstate_t, voice_threads),
+		.type = LV2_ATOM__Int,
+		.event_cb = _intercept_voice_threads
+	},
+	{
+		.property = MEPHISTO__voiceLoad,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, voice_load),
+		.type = LV2_ATOM__String,
+		.max_size = LOAD_SIZE
+	},
+	{
+		.property = MEPHISTO__parallel,
+		.offset = offsetof(plugstate_t, parallel),
+		.type = LV2_ATOM__Bool,
+		.event_cb = _intercept_code
+	},
+	{
+		.property = MEPHISTO__tuning,
+		.offset = offsetof(plugstate_t, tuning),
+		.type = LV2_ATOM__Path,
+		.max_size = TUNING_SIZE,
+		.event_cb = _intercept_tuning
+	},
+	CONTROL(1),
+	CONTROL(2),
+	CONTROL(3),
+	CONTROL(4),
+	CONTROL(5),
+	CONTROL(6),
+	CONTROL(7),
+	CONTROL(1),
+	CONTROL(9),
+	CONTROL(10),
+	CONTROL(11),
+	CONTROL(12),
+	CONTROL(13),
+	CONTROL(14),
+	CONTROL(15),
+	CONTROL(16)
+};
+
+static inline float
+_voice_peak(uint32_t nouts, uint32_t nsamples, FAUSTFLOAT *audio_out [])
+{
+	float peak = 0.f;
+
+	for(uint32_t n = 0; n < nouts; n++)
+	{
+		for(uint32_t i = 0; i < nsamples; i++)
+		{
+			peak = fmaxf(peak, fabsf(audio_out[n][i]));
+		}
+	}
+
+	return peak;
+}
+
+// parks a released voice once its output stayed below the silence threshold
+// for the configured number of consecutive blocks
+static inline void
+_voice_track_silence(plughandle_t *handle, voice_t *voice)
+{
+	if(voice->peak >= handle->silence_level)
+	{
+		voice->silent = 0;
+	}
+	else if(++voice->silent >= (uint32_t)handle->state.silence_blocks)
+	{
+		voice->parked = true;
+	}
+}
+
+// whether the host processes in-place, e.g. an input aliases any output
+static inline bool
+_in_place(plughandle_t *handle, const float *audio_in, float *audio_out [])
+{
+	for(uint32_t n = 0; n < handle->nchannel; n++)
+	{
+		if(audio_in == audio_out[n])
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// equal-power crossfade gain with xfade_cur samples of the crossfade left
+static inline float
+_xfade_gain(plughandle_t *handle, uint32_t xfade_cur, bool fade_out)
+{
+	const float t = 2.f * xfade_cur / handle->xfade_max - 1.f;
+
+	return fade_out
+		? sqrtf(0.5f * (1.f + t) )
+		: sqrtf(0.5f * (1.f - t) );
+}
+
+// computes a single voice, tracks its tail once released and its level if
+// needed for stealing
+static inline void
+_voice_render(plughandle_t *handle, dsp_t *dsp, voice_t *voice, uint32_t nouts,
+	uint32_t nsamples, FAUSTFLOAT **inputs, FAUSTFLOAT **outputs)
+{
+	if(voice->retrigger)
+	{
+		_cntrl_refresh_value_abs(&voice->gate, 0.f);
+		_voice_compute(dsp, voice, 1, inputs, outputs);
+		_cntrl_refresh_value_abs(&voice->gate, 1.f);
+
+		voice->retrigger = false;
+	}
+
+	_voice_compute(dsp, voice, nsamples, inputs, outputs);
+
+	if(!dsp->is_instrument)
+	{
+		return;
+	}
+
+	if(voice->state == VOICE_STATE_INACTIVE)
+	{
+		voice->peak = _voice_peak(nouts, nsamples, outputs);
+		_voice_track_silence(handle, voice);
+	}
+	else if(dsp->steal == STEAL_QUIETEST)
+	{
+		voice->peak = _voice_peak(nouts, nsamples, outputs);
+	}
+}
+
+static inline void
+_mix(plughandle_t *handle, float *audio_out [], FAUSTFLOAT *src [],
+	uint32_t nouts, uint32_t nsamples, float gain0, float gain1)
+{
+	for(uint32_t n = 0; n < nouts; n++)
+	{
+		if(gain0 == gain1)
+		{
+			handle->kernel.mix(audio_out[n], src[n], gain0, nsamples);
+		}
+		else
+		{
+			handle->kernel.mix_ramp(audio_out[n], src[n], gain0, gain1, nsamples);
+		}
+	}
+}
+
+// lists the voices to render, returns their number
+static inline uint32_t
+_voice_pool_gather(voice_pool_t *vpool, dsp_t *dsp)
+{
+	vpool->dsp = dsp;
+	vpool->nvoices = 0;
+
+	VOICE_FOREACH(dsp, voice)
+	{
+		if(!voice->parked)
+		{
+			vpool->voices[vpool->nvoices++] = voice;
+		}
+	}
+
+	return vpool->nvoices;
+}
+
+// runs on all lanes concurrently, sums the voices it claims into the lane
+static void
+_voice_pool_lane(void *data, uint32_t l)
+{
+	voice_pool_t *vpool = data;
+	plughandle_t *handle = vpool->handle;
+	voice_lane_t *lane = &vpool->lanes[l];
+	dsp_t *dsp = vpool->dsp;
+	FAUSTFLOAT *direct [MAX_IO];
+	FAUSTFLOAT *scratch [MAX_IO];
+	uint32_t v;
+
+	for(uint32_t o = 0; o < dsp->nouts; o++)
+	{
+		direct[o] = (o < vpool->nouts)
+			? lane->out[o]
+			: lane->surplus;
+		scratch[o] = (o < vpool->nouts)
+			? lane->scratch[o]
+			: lane->surplus;
+	}
+
+	// voices are claimed one by one, which balances uneven voice costs, lanes
+	// entering late simply find none left
+	while( (v = atomic_fetch_add_explicit(&vpool->next, 1, memory_order_relaxed))
+		< vpool->nvoices)
+	{
+		voice_t *voice = vpool->voices[v];
+
+		if(!lane->rendered)
+		{
+			_voice_render(handle, dsp, voice, vpool->nouts, vpool->nsamples,
+				vpool->inputs, direct);
+
+			lane->rendered = true;
+		}
+		else
+		{
+			_voice_render(handle, dsp, voice, vpool->nouts, vpool->nsamples,
+				vpool->inputs, scratch);
+
+			for(uint32_t n = 0; n < vpool->nouts; n++)
+			{
+				handle->kernel.mix(lane->out[n], lane->scratch[n], 1.f,
+					vpool->nsamples);
+			}
+		}
+	}
+}
+
+// renders the gathered voices on all lanes and sums up the lanes
+static inline bool
+_voice_pool_render(plughandle_t *handle, FAUSTFLOAT **inputs,
+	float *audio_out [], uint32_t nouts, uint32_t nsamples, float gain0,
+	float gain1, bool rendered)
+{
+	voice_pool_t *vpool = handle->pool;
+	const uint32_t nlanes = pool_lanes(vpool->pool);
+
+	vpool->inputs = inputs;
+	vpool->nouts = nouts;
+	vpool->nsamples = nsamples;
+	atomic_store_explicit(&vpool->next, 0, memory_order_relaxed);
+
+	// helpers may miss a run, their lanes must not be summed up then
+	for(uint32_t l = 0; l < nlanes; l++)
+	{
+		vpool->lanes[l].rendered = false;
+	}
+
+	pool_run(vpool->pool);
+
+	for(uint32_t l = 0; l < nlanes; l++)
+	{
+		voice_lane_t *lane = &vpool->lanes[l];
+
+		if(!lane->rendered)
+		{
+			continue;
+		}
+
+		if(!rendered && (gain0 == 1.f) && (gain1 == 1.f) )
+		{
+			for(uint32_t n = 0; n < handle->nchannel; n++)
+			{
+				if(n < nouts)
+				{
+					handle->kernel.copy(audio_out[n], lane->out[n], nsamples);
+				}
+				else
+				{
+					handle->kernel.clear(audio_out[n], nsamples);
+				}
+			}
+		}
+		else
+		{
+			if(!rendered)
+			{
+				for(uint32_t n = 0; n < handle->nchannel; n++)
+				{
+					handle->kernel.clear(audio_out[n], nsamples);
+				}
+			}
+
+			_mix(handle, audio_out, lane->out, nouts, nsamples, gain0, gain1);
+		}
+
+		rendered = true;
+	}
+
+	return rendered;
+}
+
+static inline void
+_render(plughandle_t *handle, const float *host_in [], float *audio_out [],
+	uint32_t nsamples)
+{
+	FAUSTFLOAT *audio_in [MAX_CHANNEL];
+	bool rendered = false;
+
+	// hand over host inputs directly, unless outputs overwrite them
+	for(uint32_t n = 0; n < handle->nchannel; n++)
+	{
+		if(_in_place(handle, host_in[n], audio_out))
+		{
+			handle->kernel.copy(handle->faudio_in[n], host_in[n], nsamples);
+			audio_in[n] = handle->faudio_in[n];
+		}
+		else
+		{
+			audio_in[n] = (FAUSTFLOAT *)host_in[n];
+		}
+	}
+
+	const bool off [2] = {
+		handle->play,
+		!handle->play
+	};
+
+	for(uint32_t d = 0; d < 2; d++)
+	{
+		dsp_t *dsp = handle->dsp[off[d]];
+
+		if(!dsp)
+		{
+			continue;
+		}
+
+		// gain is ramped from start to end of this segment while crossfading
+		float gain0 = 1.f;
+		float gain1 = 1.f;
+
+		if(handle->xfade_cur > 0)
+		{
+			const uint32_t xfade_end = (nsamples < handle->xfade_cur)
+				? handle->xfade_cur - nsamples
+				: 0;
+
+			gain0 = _xfade_gain(handle, handle->xfade_cur, d == 0);
+			gain1 = _xfade_gain(handle, xfade_end, d == 0);
+		}
+		else
+		{
+			if(d == 1)
+			{
+				continue; // skip this
+			}
+		}
+
+		// bind exactly the DSP's ins and outs, surplus ones to silence/scratch
+		FAUSTFLOAT *inputs [MAX_IO];
+		FAUSTFLOAT *direct [MAX_IO];
+		FAUSTFLOAT *scratch [MAX_IO];
+		const uint32_t nouts = (dsp->nouts < handle->nchannel)
+			? dsp->nouts
+			: handle->nchannel;
+
+		for(uint32_t i = 0; i < dsp->nins; i++)
+		{
+			inputs[i] = (i < handle->nchannel)
+				? audio_in[i]
+				: handle->silence;
+		}
+
+		for(uint32_t o = 0; o < dsp->nouts; o++)
+		{
+			direct[o] = (o < handle->nchannel)
+				? audio_out[o]
+				: handle->scratch;
+			scratch[o] = (o < handle->nchannel)
+				? handle->faudio_out[o]
+				: handle->scratch;
+		}
+
+		// spread voices over the pool, if there is more than one to render
+		if(handle->pool && (_voice_pool_gather(handle->pool, dsp) > 1) )
+		{
+			rendered = _voice_pool_render(handle, inputs, audio_out, nouts,
+				nsamples, gain0, gain1, rendered);
+
+			continue;
+		}
+
+		VOICE_FOREACH(dsp, voice)
+		{
+			// released voices whose tail has decayed are not computed at all
+			if(voice->parked)
+			{
+				continue;
+			}
+
+			// the first voice renders to the host outputs, others are mixed in
+			const bool first = !rendered && (gain0 == 1.f) && (gain1 == 1.f);
+			FAUSTFLOAT **outputs = first
+				? direct
+				: scratch;
+
+			if(!rendered)
+			{
+				for(uint32_t n = first ? nouts : 0; n < handle->nchannel; n++)
+				{
+					handle->kernel.clear(audio_out[n], nsamples);
+				}
+
+				rendered = true;
+			}
+
+			_voice_render(handle, dsp, voice, nouts, nsamples, inputs, outputs);
+
+			if(!first)
+			{
+				// add to master out
+				_mix(handle, audio_out, scratch, nouts, nsamples, gain0, gain1);
+			}
+		}
+	}
+
+	if(!rendered)
+	{
+		for(uint32_t n = 0; n < handle->nchannel; n++)
+		{
+			handle->kernel.clear(audio_out[n], nsamples);
+		}
+	}
+
+	if(handle->xfade_cur > 0)
+	{
+		if(nsamples >= handle->xfade_cur)
+		{
+			handle->xfade_cur = 0;
+
+			// switch dsps
+			handle->play = !handle->play;
+		}
+		else
+		{
+			handle->xfade_cur -= nsamples;
+		}
+	}
+}
+
+// pushes host inputs into and pulls host outputs from the fifo, rendering
+// whenever a whole internal block has been gathered
+static inline void
+_play_fifo(plughandle_t *handle, int64_t from, int64_t to)
+{
+	const uint32_t block_length = handle->state.block_length;
+
+	while(from < to)
+	{
+		const uint32_t left = block_length - handle->fifo_pos;
+		const uint32_t nsamples = (to - from < left)
+			? to - from
+			: left;
+
+		// all inputs are read before any outputs are written, in case they alias
+		for(uint32_t n = 0; n < handle->nchannel; n++)
+		{
+			handle->kernel.copy(&handle->fifo_in[n][handle->fifo_pos],
+				&handle->audio_in[n][from], nsamples);
+		}
+
+		for(uint32_t n = 0; n < handle->nchannel; n++)
+		{
+			handle->kernel.copy(&handle->audio_out[n][from],
+				&handle->fifo_out[n][handle->fifo_pos], nsamples);
+		}
+
+		handle->fifo_pos += nsamples;
+		from += nsamples;
+
+		if(handle->fifo_pos == block_length)
+		{
+			_render(handle, (const float **)handle->fifo_in, handle->fifo_out,
+				block_length);
+
+			handle->fifo_pos = 0;
+		}
+	}
+}
+
+static inline void
+_play(plughandle_t *handle, int64_t from, int64_t to)
+{
+	const uint32_t block_length = handle->state.block_length;
+	const float *audio_in [MAX_CHANNEL];
+	float *audio_out [MAX_CHANNEL];
+
+	if(handle->fifo_latency)
+	{
+		_play_fifo(handle, from, to);
+
+		return;
+	}
+
+	// host blocks are whole internal blocks, slices are aligned by _quantize
+	while(from < to)
+	{
+		const uint32_t nsamples = (block_length && (to - from > block_length))
+			? block_length
+			: to - from;
+
+		for(uint32_t n = 0; n < handle->nchannel; n++)
+		{
+			audio_in[n] = &handle->audio_in[n][from];
+			audio_out[n] = &handle->audio_out[n][from];
+		}
+
+		_render(handle, audio_in, audio_out, nsamples);
+
+		from += nsamples;
+	}
+}
+
+static inline uint64_t
+_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+_timely_cb(timely_t *timely __attribute__((unused)),
+	int64_t frames __attribute__((unused)), LV2_URID type __attribute__((unused)),
+	void *data __attribute__((unused)))
+{
+	// nothing to do
+}
+
+static int
+_dsp_dir_popen(char *buf, size_t len)
+{
+	FILE *fin = popen("faust -dspdir 2>/dev/null", "r");
+	if(!fin)
+	{
+		return -1;
+	}
+
+	const size_t sz = fread(buf, 1, len - 1, fin);
+	pclose(fin);
+
+	if(sz == 0)
+	{
+		return 1;
+	}
+
+	buf[sz] = '\0';
+
+	char *esc = strpbrk(buf, "\n\r");
+	if(esc)
+	{
+		*esc = '\0';
+	}
+
+	return 0;
+}
+
+static bool
+_dsp_dir_valid(const char *path)
+{
+	struct stat st;
+
+	return path && (path[0] == '/')
+		&& (stat(path, &st) == 0) && S_ISDIR(st.st_mode);
+}
+
+// resolves the FAUST DSP library directory, preferring an environment
+// override, then the directory found at build time and only then asking
+// the faust binary
+static int
+_dsp_dir(char *buf, size_t len)
+{
+	const char *env = getenv("MEPHISTO_DSP_DIR");
+
+	if(_dsp_dir_valid(env))
+	{
+		snprintf(buf, len, "%s", env);
+		return 0;
+	}
+
+#if defined(FAUST_DSP_DIR)
+	if(_dsp_dir_valid(FAUST_DSP_DIR))
+	{
+		snprintf(buf, len, "%s", FAUST_DSP_DIR);
+		return 0;
+	}
+#endif
+
+	if( (_dsp_dir_popen(buf, len) == 0) && _dsp_dir_valid(buf) )
+	{
+		return 0;
+	}
+
+	buf[0] = '\0';
+
+	return -1;
+}
+
+static inline float
+_midi2cps(float pitch)
+{
+	return exp2f( (pitch - 69.f) / 12.f) * 440.f;
+}
+
+// frequency factor of a transposition, looked up at 1/BEND_FINE semitones
+static inline float
+_semi2factor(float semi)
+{
+	const float pos = (semi + BEND_SEMI_MAX) * BEND_FINE;
+
+	if(pos <= 0.f)
+	{
+		return bend_coarse[0];
+	}
+
+	const uint32_t step = lrintf(pos);
+
+	if(step >= 2*BEND_SEMI_MAX*BEND_FINE)
+	{
+		return bend_coarse[2*BEND_SEMI_MAX];
+	}
+
+	return bend_coarse[step / BEND_FINE] * bend_fine[step % BEND_FINE];
+}
+
+// whether target's architecture matches host's and its cpu and features, if
+// given, match them exactly
+static bool
+_target_matches(const char *target, const char *host)
+{
+	const size_t len = strcspn(host, "-:");
+	const char *cpu = strchr(target, ':');
+	const char *host_cpu = strchr(host, ':');
+
+	if(strncmp(target, host, len)
+		|| ( (target[len] != '-') && (target[len] != ':') && (target[len] != '\0') ) )
+	{
+		return false;
+	}
+
+	return !cpu || (host_cpu && !strcmp(cpu, host_cpu));
+}
+
+static void
+_init_once(void)
+{
+	char *target = getCDSPMachineTarget();
+
+	if(target)
+	{
+		strncpy(machine_target, target, sizeof(machine_target) - 1);
+		freeCMemory(target);
+	}
+
+	// explicit triple and cpu of this host, unless overridden by one LLVM
+	// reports this host to support, or by the generic one
+	const char *env = getenv("MEPHISTO_TARGET");
+	const bool override = env
+		&& ( (env[0] == '\0') || _target_matches(env, machine_target) );
+
+	snprintf(native_target, sizeof(native_target), "%s",
+		override ? env : machine_target);
+
+	_dsp_dir(dsp_dir, sizeof(dsp_dir));
+
+	for(uint32_t key = 0; key < 0x80; key++)
+	{
+		key_freq[key] = _midi2cps(key);
+	}
+
+	for(int32_t semi = -BEND_SEMI_MAX; semi <= BEND_SEMI_MAX; semi++)
+	{
+		bend_coarse[semi + BEND_SEMI_MAX] = exp2f(semi / 12.f);
+	}
+
+	for(uint32_t step = 0; step < BEND_FINE; step++)
+	{
+		bend_fine[step] = exp2f(step / (12.f * BEND_FINE));
+	}
+
+	const long nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+
+	ncpus = (nprocs > 0)
+		? nprocs
+		: 1;
+	sched.slots = ncpus;
+}
+
+static void
+_tuning_reset(tuning_t *tuning)
+{
+	for(uint32_t chn = 0; chn < 0x10; chn++)
+	{
+		memcpy(tuning->freq[chn], key_freq, sizeof(key_freq));
+	}
+}
+
+static int
+_mkpath(char *path)
+{
+	for(char *sep = strchr(path + 1, '/'); sep; sep = strchr(sep + 1, '/'))
+	{
+		*sep = '\0';
+		const int ret = mkdir(path, 0755);
+		*sep = '/';
+
+		if( (ret != 0) && (errno != EEXIST) )
+		{
+			return -1;
+		}
+	}
+
+	if( (mkdir(path, 0755) != 0) && (errno != EEXIST) )
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+_cache_dir(char *buf, size_t len)
+{
+	const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	int ret;
+
+	if(xdg_cache_home && (xdg_cache_home[0] == '/') )
+	{
+		ret = snprintf(buf, len, "%s/mephisto.lv2", xdg_cache_home);
+	}
+	else if(home && (home[0] == '/') )
+	{
+		ret = snprintf(buf, len, "%s/.cache/mephisto.lv2", home);
+	}
+	else
+	{
+		return -1;
+	}
+
+	if( (ret < 0) || ((size_t)ret >= len) )
+	{
+		return -1;
+	}
+
+	return _mkpath(buf);
+}
+
+static inline uint64_t
+_fnv1a(uint64_t hash, const void *data, size_t len)
+{
+	const uint8_t *byte = data;
+
+	for(size_t i = 0; i < len; i++)
+	{
+		hash ^= byte[i];
+		hash *= UINT64_C(0x100000001b3);
+	}
+
+	return hash;
+}
+
+// order-independent digest of name, size and mtime of all libraries in an
+// import directory, as imported code is not part of the code itself
+static uint64_t
+_libraries_key(const char *dir)
+{
+	DIR *dirp = opendir(dir);
+	uint64_t sum = 0;
+
+	if(!dirp)
+	{
+		return 0;
+	}
+
+	struct dirent *entry;
+	while( (entry = readdir(dirp)) )
+	{
+		const char *suffix = strrchr(entry->d_name, '.');
+		struct stat st;
+
+		if(!suffix || strcmp(suffix, ".lib")
+			|| (fstatat(dirfd(dirp), entry->d_name, &st, 0) != 0) )
+		{
+			continue;
+		}
+
+		uint64_t hash = UINT64_C(0xcbf29ce484222325);
+
+		hash = _fnv1a(hash, entry->d_name, strlen(entry->d_name) + 1);
+		hash = _fnv1a(hash, &st.st_size, sizeof(st.st_size));
+		hash = _fnv1a(hash, &st.st_mtim, sizeof(st.st_mtim));
+
+		sum += hash;
+	}
+
+	closedir(dirp);
+
+	return sum;
+}
+
+static uint64_t
+_factory_key(const char *code, int argc, const char *argv [],
+	const char *target)
+{
+	const char *version = getCLibFaustVersion();
+	uint64_t hash = UINT64_C(0xcbf29ce484222325);
+
+	// hash terminating zeros, too, to separate the individual fields
+	hash = _fnv1a(hash, code, strlen(code) + 1);
+
+	for(int i = 0; i < argc; i++)
+	{
+		hash = _fnv1a(hash, argv[i], strlen(argv[i]) + 1);
+
+		if(!strcmp(argv[i], "-I") && (i + 1 < argc) )
+		{
+			const uint64_t libs = _libraries_key(argv[i + 1]);
+
+			hash = _fnv1a(hash, &libs, sizeof(libs));
+		}
+	}
+
+	hash = _fnv1a(hash, version, strlen(version) + 1);
+	hash = _fnv1a(hash, machine_target, strlen(machine_target) + 1);
+	hash = _fnv1a(hash, target, strlen(target) + 1);
+#if defined(_FAUST_HAS_MEMORY_MANAGER)
+	hash = _fnv1a(hash, "-mem", sizeof("-mem"));
+#endif
+
+	return hash;
+}
+
+// code, arguments and target separated by zeros, as hashed into the key
+static char *
+_factory_source(const char *code, int argc, const char *argv [],
+	const char *target, size_t *len)
+{
+	size_t sz = strlen(code) + strlen(target) + 2;
+
+	for(int i = 0; i < argc; i++)
+	{
+		sz += strlen(argv[i]) + 1;
+	}
+
+	char *source = malloc(sz);
+	if(!source)
+	{
+		return NULL;
+	}
+
+	char *dst = source;
+
+	dst = stpcpy(dst, code) + 1;
+	for(int i = 0; i < argc; i++)
+	{
+		dst = stpcpy(dst, argv[i]) + 1;
+	}
+	stpcpy(dst, target);
+
+	*len = sz;
+
+	return source;
+}
+
+// must be called with lock held, hash collisions must never hand out the
+// factory of other code
+static inline bool
+_factory_match(const factory_t *factory, uint64_t key, uint32_t srate,
+	const char *source, size_t source_len)
+{
+	// static tables may depend on the sample rate
+	return (factory->key == key)
+		&& (factory->srate == srate)
+		&& (factory->source_len == source_len)
+		&& !memcmp(factory->source, source, source_len);
+}
+
+#if defined(_FAUST_HAS_MEMORY_MANAGER)
+// any thread, the allocation size is kept in front of the aligned block
+static void *
+_factory_allocate(void *iface, size_t size)
+{
+	factory_t *factory = iface;
+	uint8_t *mem = NULL;
+
+	if(posix_memalign((void **)&mem, MEMORY_ALIGN, MEMORY_ALIGN + size) != 0)
+	{
+		return NULL;
+	}
+
+	memcpy(mem, &size, sizeof(size));
+	atomic_fetch_add_explicit(&factory->allocated, size, memory_order_relaxed);
+	allocated += size;
+
+	return mem + MEMORY_ALIGN;
+}
+
+static void
+_factory_destroy(void *iface, void *ptr)
+{
+	factory_t *factory = iface;
+	uint8_t *mem = (uint8_t *)ptr - MEMORY_ALIGN;
+	size_t size;
+
+	if(!ptr)
+	{
+		return;
+	}
+
+	memcpy(&size, mem, sizeof(size));
+	atomic_fetch_sub_explicit(&factory->allocated, size, memory_order_relaxed);
+
+	free(mem);
+}
+#endif
+
+static int
+_cache_path(plughandle_t *handle, char *buf, size_t len, uint64_t key)
+{
+	if(handle->cache_dir[0] == '\0')
+	{
+		return -1;
+	}
+
+	const int ret = snprintf(buf, len, "%s/%016"PRIx64".mc",
+		handle->cache_dir, key);
+
+	if( (ret < 0) || ((size_t)ret >= len) )
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+static llvm_dsp_factory *
+_cache_load(plughandle_t *handle, const char *path, const char *target)
+{
+	char err [COMPILE_ERROR_SIZE];
+
+	if(access(path, R_OK) != 0)
+	{
+		return NULL;
+	}
+
+	memset(err, 0x0, sizeof(err));
+
+	llvm_dsp_factory *factory = readCDSPFactoryFromMachineFile(path, target, err);
+	if(!factory)
+	{
+		if(handle->log)
+		{
+			lv2_log_note(&handle->logger, "[%s] discarding stale cache entry %s: %s",
+				__func__, path, err);
+		}
+
+		unlink(path);
+	}
+	else
+	{
+		// the modification time orders entries by last use for trimming
+		utimensat(AT_FDCWD, path, NULL, 0);
+	}
+
+	return factory;
+}
+
+typedef struct _cache_entry_t cache_entry_t;
+
+struct _cache_entry_t {
+	char name [NAME_MAX + 1];
+	struct timespec mtime;
+	int64_t size;
+};
+
+static int
+_cache_entry_cmp(const void *a, const void *b)
+{
+	const cache_entry_t *entry_a = a;
+	const cache_entry_t *entry_b = b;
+
+	if(entry_a->mtime.tv_sec != entry_b->mtime.tv_sec)
+	{
+		return (entry_a->mtime.tv_sec < entry_b->mtime.tv_sec) ? -1 : 1;
+	}
+
+	if(entry_a->mtime.tv_nsec != entry_b->mtime.tv_nsec)
+	{
+		return (entry_a->mtime.tv_nsec < entry_b->mtime.tv_nsec) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+// removes least recently used entries until the cache fits CACHE_SIZE_MAX
+static void
+_cache_trim(plughandle_t *handle)
+{
+	DIR *dirp = opendir(handle->cache_dir);
+	cache_entry_t *entries = NULL;
+	uint32_t nentries = 0;
+	uint32_t size = 0;
+	int64_t total = 0;
+
+	if(!dirp)
+	{
+		return;
+	}
+
+	struct dirent *entry;
+	while( (entry = readdir(dirp)) )
+	{
+		const char *suffix = strrchr(entry->d_name, '.');
+		struct stat st;
+
+		if(!suffix || strcmp(suffix, ".mc")
+			|| (fstatat(dirfd(dirp), entry->d_name, &st, 0) != 0) )
+		{
+			continue;
+		}
+
+		if(nentries == size)
+		{
+			size = size ? size * 2 : 64;
+
+			cache_entry_t *grown = realloc(entries, size * sizeof(cache_entry_t));
+			if(!grown)
+			{
+				break;
+			}
+
+			entries = grown;
+		}
+
+		cache_entry_t *dst = &entries[nentries++];
+
+		snprintf(dst->name, sizeof(dst->name), "%s", entry->d_name);
+		dst->mtime = st.st_mtim;
+		dst->size = st.st_size;
+		total += st.st_size;
+	}
+
+	if(total > CACHE_SIZE_MAX)
+	{
+		qsort(entries, nentries, sizeof(cache_entry_t), _cache_entry_cmp);
+
+		for(uint32_t i = 0; (i < nentries) && (total > CACHE_SIZE_MAX); i++)
+		{
+			if(unlinkat(dirfd(dirp), entries[i].name, 0) == 0)
+			{
+				total -= entries[i].size;
+			}
+		}
+
+		if(handle->log)
+		{
+			lv2_log_note(&handle->logger, "[%s] trimmed to %"PRIi64" B", __func__,
+				total);
+		}
+	}
+
+	free(entries);
+	closedir(dirp);
+}
+
+static int
+_cache_store(plughandle_t *handle, llvm_dsp_factory *factory, const char *path,
+	const char *target)
+{
+	char tmp [PATH_MAX];
+
+	// write to a unique temporary file first and rename it atomically, as other
+	// instances or processes may look up the very same entry concurrently
+	const int ret = snprintf(tmp, sizeof(tmp), "%s.%d.%"PRIxPTR".tmp", path,
+		(int)getpid(), (uintptr_t)factory);
+
+	if( (ret < 0) || ((size_t)ret >= sizeof(tmp)) )
+	{
+		return -1;
+	}
+
+	if(!writeCDSPFactoryToMachineFile(factory, tmp, target))
+	{
+		if(handle->log)
+		{
+			lv2_log_note(&handle->logger, "[%s] failed to write cache entry %s",
+				__func__, path);
+		}
+
+		unlink(tmp);
+
+		return -1;
+	}
+
+	if(rename(tmp, path) != 0)
+	{
+		if(handle->log)
+		{
+			lv2_log_note(&handle->logger, "[%s] failed to store cache entry %s: %s",
+				__func__, path, strerror(errno));
+		}
+
+		unlink(tmp);
+
+		return -1;
+	}
+
+	_cache_trim(handle);
+
+	return 0;
+}
+
+// whether target runs on this host, e.g. when state with a pinned target moved
+// to a different machine, a cpu without e.g. AVX-512 would trap
+static bool
+_target_compatible(const char *target)
+{
+	if(target[0] == '\0')
+	{
+		return true; // LLVM's generic default
+	}
+
+	return _target_matches(target, machine_target)
+		|| _target_matches(target, native_target);
+}
+
+// copies the value of a [compile:...] option of the given length
+static void
+_args_scan(char *dst, size_t len, const char *src, size_t sz)
+{
+	dst[0] = '\0';
+
+	for(const char *end = src + sz; src < end; src++)
+	{
+		if( ((size_t)(end - src) >= 9) && (strncasecmp(src, "[compile:", 9) == 0) )
+		{
+			src += 9;
+
+			const char *close = memchr(src, ']', end - src);
+			if(!close)
+			{
+				close = end;
+			}
+
+			snprintf(dst, len, "%.*s", (int)(close - src), src);
+			break;
+		}
+	}
+}
+
+static inline bool
+_ident_char(char c)
+{
+	return isalnum((unsigned char)c) || (c == '_');
+}
+
+static inline const char *
+_skip_space(const char *src)
+{
+	while(isspace((unsigned char)*src))
+	{
+		src++;
+	}
+
+	return src;
+}
+
+// returns the closing quote of the string literal opened at src
+static inline const char *
+_literal_end(const char *src)
+{
+	for(src++; *src && (*src != '"'); src++)
+	{
+		if( (*src == '\\') && src[1])
+		{
+			src++;
+		}
+	}
+
+	return src;
+}
+
+// copies the [compile:...] option of the code's 'declare options' statement,
+// comments and other string literals are skipped, thus it is known before
+// compiling the code
+static void
+_args_declared(char *dst, size_t len, const char *code)
+{
+	dst[0] = '\0';
+
+	for(const char *src = code; *src; )
+	{
+		if(strncmp(src, "//", 2) == 0)
+		{
+			src = strchrnul(src, '\n');
+		}
+		else if(strncmp(src, "/*", 2) == 0)
+		{
+			const char *end = strstr(src + 2, "*/");
+
+			src = end ? end + 2 : src + strlen(src);
+		}
+		else if(*src == '"')
+		{
+			src = _literal_end(src);
+			src += (*src != '\0');
+		}
+		else if( (strncmp(src, "declare", 7) == 0) && !_ident_char(src[7])
+			&& ( (src == code) || !_ident_char(src[-1]) ) )
+		{
+			const char *ptr = _skip_space(src + 7);
+
+			src += 7;
+
+			if( (strncmp(ptr, "options", 7) != 0) || _ident_char(ptr[7]) )
+			{
+				continue;
+			}
+
+			ptr = _skip_space(ptr + 7);
+			if(*ptr == '(')
+			{
+				ptr = _skip_space(ptr + 1);
+			}
+
+			if(*ptr != '"')
+			{
+				continue;
+			}
+
+			const char *end = _literal_end(ptr);
+
+			_args_scan(dst, len, ptr + 1, end - ptr - 1);
+			if(dst[0])
+			{
+				break;
+			}
+
+			src = end + (*end != '\0');
+		}
+		else
+		{
+			src++;
+		}
+	}
+}
+
+// code generation options owned by auto-tuning, -1 for those with a value
+static int
+_args_tuned(const char *tok)
+{
+	if(!strcmp(tok, "-scal") || !strcmp(tok, "-vec") || !strcmp(tok, "-dfs"))
+	{
+		return 1;
+	}
+
+	if(!strcmp(tok, "-lv") || !strcmp(tok, "-vs"))
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+// splits options into argv, the pseudo option -target <triple[:cpu]>
+// selects the LLVM target, strip drops options owned by auto-tuning
+static void
+_args_split(args_t *args, char *options, bool strip)
+{
+	const char *sep = " \t\r\n";
+	char *saveptr = NULL;
+
+	for(char *tok = strtok_r(options, sep, &saveptr);
+		tok;
+		tok = strtok_r(NULL, sep, &saveptr))
+	{
+		const int tuned = strip ? _args_tuned(tok) : 0;
+
+		if(tuned)
+		{
+			if(tuned < 0)
+			{
+				strtok_r(NULL, sep, &saveptr); // skip value
+			}
+
+			continue;
+		}
+
+		if(!strcmp(tok, "-target"))
+		{
+			const char *machine = strtok_r(NULL, sep, &saveptr);
+
+			if(machine)
+			{
+				args->machine = machine;
+			}
+
+			continue;
+		}
+
+		if(args->argc < ARGV_MAX)
+		{
+			args->argv[args->argc++] = tok;
+		}
+	}
+}
+
+// non-rt thread, tuned options override options, per-patch [compile:...]
+// options override both
+static void
+_args_build(plughandle_t *handle, args_t *args)
+{
+	snprintf(args->tokens[0], OPTIONS_SIZE, "%s", args->options);
+	snprintf(args->tokens[1], OPTIONS_SIZE, "%s", args->tuned_options);
+	snprintf(args->tokens[2], OPTIONS_SIZE, "%s", args->compile_options);
+
+	args->argc = 0;
+	args->machine = native_target;
+	if(dsp_dir[0])
+	{
+		args->argv[args->argc++] = "-I";
+		args->argv[args->argc++] = dsp_dir;
+	}
+
+	// tuned options replace the code generation options as a whole, e.g. -scal
+	// must not end up next to -vec -lv 1
+	_args_split(args, args->tokens[0], args->tuned_options[0] != '\0');
+	_args_split(args, args->tokens[1], false);
+	_args_split(args, args->tokens[2], false);
+
+	if(args->parallel && (args->argc < ARGV_MAX) )
+	{
+		args->argv[args->argc++] = PARALLEL_OPTION;
+	}
+
+	if(!strcmp(args->machine, "native"))
+	{
+		args->machine = native_target;
+	}
+	else if(!strcmp(args->machine, "generic"))
+	{
+		args->machine = "";
+	}
+	else if(!_target_compatible(args->machine))
+	{
+		if(handle->log)
+		{
+			lv2_log_warning(&handle->logger,
+				"[%s] target '%s' does not match host '%s', using the latter",
+				__func__, args->machine, machine_target);
+		}
+
+		args->machine = native_target;
+	}
+}
+
+// non-rt thread, per-patch [compile:...] options are scanned from the code
+static void
+_args_init(plughandle_t *handle, args_t *args, bool parallel,
+	const char *options, const char *tuned, const char *code)
+{
+	args->parallel = parallel;
+	snprintf(args->options, sizeof(args->options), "%s", options);
+	snprintf(args->tuned_options, sizeof(args->tuned_options), "%s", tuned);
+	_args_declared(args->compile_options, sizeof(args->compile_options), code);
+
+	_args_build(handle, args);
+}
+
+// must be called with lock held
+static void
+_factory_unlink(factory_t *factory)
+{
+	for(factory_t **ptr = &factories; *ptr; ptr = &(*ptr)->next)
+	{
+		if(*ptr == factory)
+		{
+			*ptr = factory->next;
+			break;
+		}
+	}
+}
+
+// must be called with lock held, returns factory to free without lock held
+static factory_t *
+_factory_release(factory_t *factory)
+{
+	if(--factory->refs > 0)
+	{
+		return NULL;
+	}
+
+	_factory_unlink(factory);
+
+	return factory;
+}
+
+static void
+_factory_detach(factory_t *factory);
+
+static void
+_factory_free(factory_t *factory)
+{
+	if(!factory)
+	{
+		return;
+	}
+
+	if(factory->factory)
+	{
+		deleteCDSPFactory(factory->factory);
+	}
+
+#if defined(_FAUST_HAS_MEMORY_MANAGER)
+	if(factory->owner && (factory->owner != factory) )
+	{
+		_factory_detach(factory->owner);
+	}
+#endif
+
+	free(factory->error);
+	free(factory->source);
+	free(factory);
+}
+
+// worker thread, peeks whether newer code has been queued meanwhile, the ring
+// must not be touched from the state restore thread
+static bool
+_superseded(plughandle_t *handle)
+{
+	size_t size;
+
+	if(restoring)
+	{
+		return false;
+	}
+
+	return varchunk_read_request(handle->to_worker, &size) != NULL;
+}
+
+static void
+_sched_report(LV2_Worker_Respond_Function respond,
+	LV2_Worker_Respond_Handle target, uint32_t depth)
+{
+	const job_t job = {
+		.type = JOB_TYPE_QUEUE,
+		.depth = depth
+	};
+
+	respond(target, sizeof(job), &job);
+}
+
+// must be called with lock held, 1-based position in the queue
+static uint32_t
+_sched_position(const sched_entry_t *entry)
+{
+	uint32_t position = 1;
+
+	for(const sched_entry_t *other = sched.head;
+		other && (other != entry);
+		other = other->next)
+	{
+		position++;
+	}
+
+	return position;
+}
+
+// must be called with lock held
+static void
+_sched_unlink(sched_entry_t *entry)
+{
+	for(sched_entry_t **ptr = &sched.head; *ptr; ptr = &(*ptr)->next)
+	{
+		if(*ptr == entry)
+		{
+			*ptr = entry->next;
+			break;
+		}
+	}
+}
+
+// must be called with lock held, returns with lock held, waits in FIFO order
+// for a compile slot and reports the instance's position in the queue, the
+// lock is dropped for reporting
+static int
+_sched_enter(plughandle_t *handle, const factory_t *factory,
+	LV2_Worker_Respond_Function respond, LV2_Worker_Respond_Handle target)
+{
+	sched_entry_t entry = { .next = NULL };
+	sched_entry_t **tail = &sched.head;
+	uint32_t reported = 0;
+	int status = 0;
+
+	if(sched.queued >= SCHED_QUEUE_MAX)
+	{
+		return -1;
+	}
+
+	while(*tail)
+	{
+		tail = &(*tail)->next;
+	}
+
+	*tail = &entry;
+	sched.queued++;
+
+	while(true)
+	{
+		const uint32_t position = _sched_position(&entry);
+
+		if(position != reported)
+		{
+			pthread_mutex_unlock(&lock);
+			_sched_report(respond, target, position);
+			pthread_mutex_lock(&lock);
+
+			reported = position;
+			continue; // the queue may have moved on meanwhile
+		}
+
+		if( (sched.head == &entry) && (sched.running < sched.slots) )
+		{
+			break;
+		}
+
+		// give up our place in the queue as soon as newer code is pending,
+		// unless other instances wait for the very same factory
+		if( (factory->refs == 1) && _superseded(handle) )
+		{
+			status = -2;
+			break;
+		}
+
+		struct timespec to;
+		clock_gettime(CLOCK_REALTIME, &to);
+		to.tv_nsec += SCHED_POLL_NS;
+		if(to.tv_nsec >= 1000000000)
+		{
+			to.tv_sec += 1;
+			to.tv_nsec -= 1000000000;
+		}
+
+		pthread_cond_timedwait(&cond, &lock, &to);
+	}
+
+	_sched_unlink(&entry);
+	sched.queued--;
+
+	if(status == 0)
+	{
+		sched.running++;
+	}
+
+	// positions of the others have changed
+	pthread_cond_broadcast(&cond);
+
+	pthread_mutex_unlock(&lock);
+	_sched_report(respond, target, 0);
+	pthread_mutex_lock(&lock);
+
+	return status;
+}
+
+// must be called with lock held
+static void
+_sched_leave(void)
+{
+	sched.running--;
+
+	pthread_cond_broadcast(&cond);
+}
+
+#if defined(_FAUST_HAS_MEMORY_MANAGER)
+// libFAUST hands out the very same factory for code and options that expand
+// alike, e.g. differing in comments only. Its static tables are owned by the
+// first one and can only be initialized for a single sample rate
+static int
+_factory_claim(plughandle_t *handle, factory_t *factory,
+	llvm_dsp_factory *llvm_factory, char *err)
+{
+	factory_t *owner = factory;
+
+	pthread_mutex_lock(&lock);
+
+	for(factory_t *other = factories; other; other = other->next)
+	{
+		if( (other != factory) && (other->tables == llvm_factory) )
+		{
+			owner = other;
+			break;
+		}
+	}
+
+	if(owner == factory)
+	{
+		factory->tables = llvm_factory;
+	}
+	else if(owner->srate != handle->srate)
+	{
+		pthread_mutex_unlock(&lock);
+
+		snprintf(err, COMPILE_ERROR_SIZE,
+			"code already runs at %"PRIu32" Hz in this process, static tables "
+			"cannot be shared across sample rates", owner->srate);
+
+		return -1;
+	}
+	else
+	{
+		owner->refs++;
+
+		// wait for the owner to initialize the static tables
+		while(!owner->factory)
+		{
+			pthread_cond_wait(&cond, &lock);
+		}
+	}
+
+	factory->owner = owner;
+
+	pthread_mutex_unlock(&lock);
+
+	return 0;
+}
+#endif
+
+static factory_t *
+_factory_attach(plughandle_t *handle, const char *code, int argc,
+	const char *argv [], const char *machine, char *err,
+	LV2_Worker_Respond_Function respond, LV2_Worker_Respond_Handle target)
+{
+	char path [PATH_MAX];
+	const uint64_t key = _factory_key(code, argc, argv, machine);
+	size_t source_len = 0;
+	char *source = _factory_source(code, argc, argv, machine, &source_len);
+
+	if(!source)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&lock);
+
+	for(factory_t *factory = factories; factory; factory = factory->next)
+	{
+		if(!_factory_match(factory, key, handle->srate, source, source_len))
+		{
+			continue;
+		}
+
+		free(source);
+		factory->refs++;
+
+		// wait for a concurrent compilation of the very same code to finish
+		while(!factory->factory && !factory->error)
+		{
+			pthread_cond_wait(&cond, &lock);
+		}
+
+		if(factory->error)
+		{
+			strncpy(err, factory->error, COMPILE_ERROR_SIZE - 1);
+
+			factory = _factory_release(factory);
+			pthread_mutex_unlock(&lock);
+
+			_factory_free(factory);
+
+			return NULL;
+		}
+
+		pthread_mutex_unlock(&lock);
+
+		if(handle->log)
+		{
+			lv2_log_note(&handle->logger, "[%s] attached to shared factory",
+				__func__);
+		}
+
+		return factory;
+	}
+
+	factory_t *factory = calloc(1, sizeof(factory_t));
+	if(!factory)
+	{
+		pthread_mutex_unlock(&lock);
+
+		free(source);
+
+		return NULL;
+	}
+
+	// publish the pending factory, so others wait for it instead of compiling
+	factory->key = key;
+	factory->source = source;
+	factory->source_len = source_len;
+	factory->srate = handle->srate;
+	factory->refs = 1;
+	factory->next = factories;
+	factories = factory;
+
+	const int status = _sched_enter(handle, factory, respond, target);
+	if(status != 0)
+	{
+		if(status == -2)
+		{
+			snprintf(err, COMPILE_ERROR_SIZE, "superseded by newer code");
+		}
+		else
+		{
+			snprintf(err, COMPILE_ERROR_SIZE, "compile queue full (%"PRIu32" pending)",
+				sched.queued);
+		}
+		factory->error = strdup(err);
+
+		// failed factories must not be found by anyone anymore
+		_factory_unlink(factory);
+		factory = _factory_release(factory);
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&lock);
+
+		_factory_free(factory);
+
+		return NULL;
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	llvm_dsp_factory *llvm_factory = NULL;
+	const bool cached = _cache_path(handle, path, sizeof(path), key) == 0;
+	bool stored = false;
+
+	if(cached)
+	{
+		llvm_factory = _cache_load(handle, path, machine);
+	}
+
+	if(!llvm_factory)
+	{
+#if defined(_FAUST_HAS_MEMORY_MANAGER)
+		// allocate static tables and instance memory via the memory manager
+		const char *argv_mem [ARGV_MAX + 1];
+
+		memcpy(argv_mem, argv, argc * sizeof(const char *));
+		argv_mem[argc++] = "-mem";
+		argv = argv_mem;
+#endif
+
+		llvm_factory = createCDSPFactoryFromString("mephisto", code, argc, argv,
+			machine, err, -1);
+
+		if(llvm_factory && cached)
+		{
+			stored = _cache_store(handle, llvm_factory, path, machine) == 0;
+		}
+	}
+	else
+	{
+		stored = true;
+
+		if(handle->log)
+		{
+			lv2_log_note(&handle->logger, "[%s] loaded from cache %s", __func__, path);
+		}
+	}
+
+#if defined(_FAUST_HAS_MEMORY_MANAGER)
+	if(llvm_factory && (_factory_claim(handle, factory, llvm_factory, err) != 0) )
+	{
+		// libFAUST keeps a reference per factory handed out
+		deleteCDSPFactory(llvm_factory);
+
+		llvm_factory = NULL;
+	}
+#endif
+
+	if(!llvm_factory)
+	{
+		pthread_mutex_lock(&lock);
+
+		factory->error = strdup(err[0] ? err : "factory creation failed");
+		_sched_leave();
+
+		// failed factories must not be found by anyone anymore
+		_factory_unlink(factory);
+		factory = _factory_release(factory);
+		pthread_mutex_unlock(&lock);
+
+		_factory_free(factory);
+
+		return NULL;
+	}
+
+	struct stat st;
+	const int64_t size = (stored && (stat(path, &st) == 0) )
+		? st.st_size
+		: 0;
+
+#if defined(_FAUST_HAS_MEMORY_MANAGER)
+	if(factory->owner == factory)
+	{
+		factory->manager.managerInterface = factory;
+		factory->manager.allocate = _factory_allocate;
+		factory->manager.destroy = _factory_destroy;
+		// static tables are initialized once and shared by all instances
+		pthread_mutex_lock(&faust_lock);
+		setCMemoryManager(llvm_factory, &factory->manager);
+		classCInit(llvm_factory, handle->srate);
+		pthread_mutex_unlock(&faust_lock);
+
+		if(handle->log)
+		{
+			lv2_log_note(&handle->logger, "[%s] static tables: %"PRIi64" B shared",
+				__func__, atomic_load_explicit(&factory->allocated, memory_order_relaxed));
+		}
+	}
+#endif
+
+	pthread_mutex_lock(&lock);
+
+	factory->factory = llvm_factory;
+	factory->size = size;
+	_sched_leave();
+	pthread_mutex_unlock(&lock);
+
+	return factory;
+}
+
+static void
+_factory_detach(factory_t *factory)
+{
+	pthread_mutex_lock(&lock);
+
+	factory = _factory_release(factory);
+
+	pthread_mutex_unlock(&lock);
+
+	_factory_free(factory);
+}
+
+#if defined(_FAUST_HAS_INTERPRETER)
+// whether a compiled factory is readily available in the registry or cache
+static bool
+_factory_hot(plughandle_t *handle, const char *code, int argc,
+	const char *argv [], const char *machine)
+{
+	char path [PATH_MAX];
+	const uint64_t key = _factory_key(code, argc, argv, machine);
+	size_t source_len = 0;
+	char *source = _factory_source(code, argc, argv, machine, &source_len);
+	bool hot = false;
+
+	if(!source)
+	{
+		return false;
+	}
+
+	pthread_mutex_lock(&lock);
+
+	for(factory_t *factory = factories; factory; factory = factory->next)
+	{
+		if(_factory_match(factory, key, handle->srate, source, source_len)
+			&& factory->factory)
+		{
+			hot = true;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	free(source);
+
+	if(!hot && (_cache_path(handle, path, sizeof(path), key) == 0) )
+	{
+		hot = access(path, R_OK) == 0;
+	}
+
+	return hot;
+}
+#endif
+
+static FAUSTFLOAT *
+_buffer_new(uint32_t nsamples)
+{
+	const size_t len = sizeof(FAUSTFLOAT) * nsamples;
+	FAUSTFLOAT *buf = NULL;
+
+	if(posix_memalign((void **)&buf, MEMORY_ALIGN, len) != 0)
+	{
+		return NULL;
+	}
+
+	memset(buf, 0x0, len);
+
+	return buf;
+}
+
+// internal blocks may exceed host blocks
+static inline uint32_t
+_render_length(plughandle_t *handle)
+{
+	return (handle->max_block_length > BLOCK_LENGTH_MAX)
+		? handle->max_block_length
+		: BLOCK_LENGTH_MAX;
+}
+
+static int
+_buffers_init(plughandle_t *handle)
+{
+	const uint32_t nsamples = _render_length(handle);
+
+	for(uint32_t n = 0; n < handle->nchannel; n++)
+	{
+		handle->faudio_in[n] = _buffer_new(nsamples);
+		handle->faudio_out[n] = _buffer_new(nsamples);
+		handle->fifo_in[n] = _buffer_new(BLOCK_LENGTH_MAX);
+		handle->fifo_out[n] = _buffer_new(BLOCK_LENGTH_MAX);
+
+		if(  !handle->faudio_in[n] || !handle->faudio_out[n]
+			|| !handle->fifo_in[n] || !handle->fifo_out[n])
+		{
+			return -1;
+		}
+	}
+
+	handle->silence = _buffer_new(nsamples);
+	handle->scratch = _buffer_new(nsamples);
+
+	if(!handle->silence || !handle->scratch)
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+_buffers_deinit(plughandle_t *handle)
+{
+	for(uint32_t n = 0; n < handle->nchannel; n++)
+	{
+		free(handle->faudio_in[n]);
+		free(handle->faudio_out[n]);
+		free(handle->fifo_in[n]);
+		free(handle->fifo_out[n]);
+	}
+
+	free(handle->silence);
+	free(handle->scratch);
+}
+
+// non-rt thread
+static void
+_voice_pool_free(voice_pool_t *vpool)
+{
+	if(!vpool)
+	{
+		return;
+	}
+
+	pool_free(vpool->pool);
+
+	for(uint32_t l = 0; l < POOL_THREADS_MAX; l++)
+	{
+		voice_lane_t *lane = &vpool->lanes[l];
+
+		for(uint32_t n = 0; n < MAX_CHANNEL; n++)
+		{
+			free(lane->out[n]);
+			free(lane->scratch[n]);
+		}
+
+		free(lane->surplus);
+	}
+
+	free(vpool);
+}
+
+// non-rt thread
+static voice_pool_t *
+_voice_pool_new(plughandle_t *handle, uint32_t nlanes)
+{
+	const uint32_t nsamples = _render_length(handle);
+	voice_pool_t *vpool = calloc(1, sizeof(voice_pool_t));
+
+	if(!vpool)
+	{
+		return NULL;
+	}
+
+	vpool->handle = handle;
+	atomic_init(&vpool->next, 0);
+
+	for(uint32_t l = 0; l < nlanes; l++)
+	{
+		voice_lane_t *lane = &vpool->lanes[l];
+
+		for(uint32_t n = 0; n < handle->nchannel; n++)
+		{
+			lane->out[n] = _buffer_new(nsamples);
+			lane->scratch[n] = _buffer_new(nsamples);
+
+			if(!lane->out[n] || !lane->scratch[n])
+			{
+				_voice_pool_free(vpool);
+				return NULL;
+			}
+		}
+
+		lane->surplus = _buffer_new(nsamples);
+
+		if(!lane->surplus)
+		{
+			_voice_pool_free(vpool);
+			return NULL;
+		}
+	}
+
+	vpool->pool = pool_new(nlanes, _voice_pool_lane, vpool);
+
+	if(!vpool->pool)
+	{
+		_voice_pool_free(vpool);
+		return NULL;
+	}
+
+	return vpool;
+}
+
+static LV2_Handle
+instantiate(const LV2_Descriptor* descriptor, double rate,
+	const char *bundle_path, const LV2_Feature *const *features)
+{
+	plughandle_t *handle = calloc(1, sizeof(plughandle_t));
+	if(!handle)
+	{
+		return NULL;
+	}
+	mlock(handle, sizeof(plughandle_t));
+
+	handle->nchannel = 1;
+	if(  !strcmp(descriptor->URI, MEPHISTO__audio_2x2)
+		|| !strcmp(descriptor->URI, MEPHISTO__cv_2x2) )
+	{
+		handle->nchannel = 2;
+	}
+	else if(!strcmp(descriptor->URI, MEPHISTO__audio_4x4)
+		|| !strcmp(descriptor->URI, MEPHISTO__cv_4x4) )
+	{
+		handle->nchannel = 4;
+	}
+	else if(!strcmp(descriptor->URI, MEPHISTO__audio_8x8)
+		|| !strcmp(descriptor->URI, MEPHISTO__cv_8x8) )
+	{
+		handle->nchannel = 8;
+	}
+
+	strncpy(handle->bundle_path, bundle_path, sizeof(handle->bundle_path) - 1);
+
+	LV2_Options_Option *opts = NULL;
+	for(unsigned i=0; features[i]; i++)
+	{
+		if(!strcmp(features[i]->URI, LV2_URID__map))
+		{
+			handle->map = features[i]->data;
+		}
+		else if(!strcmp(features[i]->URI, LV2_WORKER__schedule))
+		{
+			handle->sched= features[i]->data;
+		}
+		else if(!strcmp(features[i]->URI, LV2_LOG__log))
+		{
+			handle->log = features[i]->data;
+		}
+		else if(!strcmp(features[i]->URI, LV2_OPTIONS__options))
+		{
+			opts = features[i]->data;
+		}
+		else if(!strcmp(features[i]->URI, LV2_BUF_SIZE__fixedBlockLength))
+		{
+			handle->fixed_block_length = true;
+		}
+	}
+
+	if(!handle->map)
+	{
+		fprintf(stderr,
+			"%s: Host does not support urid:map\n", descriptor->URI);
+		free(handle);
+		return NULL;
+	}
+
+	if(!handle->sched)
+	{
+		fprintf(stderr,
+			"%s: Host does not support work:sched\n", descriptor->URI);
+		free(handle);
+		return NULL;
+	}
+
+	if(handle->log)
+	{
+		lv2_log_logger_init(&handle->logger, handle->map, handle->log);
+	}
+
+	pthread_once(&once, _init_once);
+	kernel_init(&handle->kernel);
+
+	if(handle->log)
+	{
+		lv2_log_note(&handle->logger, "[%s] host target: %s, native target: %s",
+			__func__, machine_target, native_target[0] ? native_target : "generic");
+
+		const char *env = getenv("MEPHISTO_TARGET");
+
+		if(env && strcmp(env, native_target))
+		{
+			lv2_log_warning(&handle->logger,
+				"[%s] MEPHISTO_TARGET '%s' does not match host, ignored", __func__, env);
+		}
+		lv2_log_note(&handle->logger, "[%s] mixing kernels: %s",
+			__func__, kernel_isa_name(handle->kernel.isa));
+
+		if(!dsp_dir[0])
+		{
+			lv2_log_warning(&handle->logger,
+				"[%s] FAUST DSP directory not found, set MEPHISTO_DSP_DIR", __func__);
+		}
+	}
+
+	if(_cache_dir(handle->cache_dir, sizeof(handle->cache_dir)) != 0)
+	{
+		handle->cache_dir[0] = '\0';
+
+		if(handle->log)
+		{
+			lv2_log_note(&handle->logger, "[%s] no cache directory, running uncached",
+				__func__);
+		}
+	}
+
+	lv2_atom_forge_init(&handle->forge, handle->map);
+
+	handle->midi_MidiEvent = handle->map->map(handle->map->handle,
+		LV2_MIDI__MidiEvent);
+	const LV2_URID bufsz_maxBlockLength = handle->map->map(handle->map->handle,
+		LV2_BUF_SIZE__maxBlockLength);
+	const LV2_URID bufsz_nominalBlockLength = handle->map->map(handle->map->handle,
+		LV2_BUF_SIZE__nominalBlockLength);
+
+	int32_t max_block_length = 0;
+	int32_t nominal_block_length = 0;
+	for(LV2_Options_Option *opt = opts;
+		(opt->key != 0) && (opt->value != NULL);
+		opt++)
+	{
+		if(  (opt->size != sizeof(int32_t))
+			|| (opt->type != handle->forge.Int) )
+		{
+			continue;
+		}
+
+		if(opt->key == bufsz_maxBlockLength)
+		{
+			max_block_length = *(const int32_t *)opt->value;
+		}
+		else if(opt->key == bufsz_nominalBlockLength)
+		{
+			nominal_block_length = *(const int32_t *)opt->value;
+		}
+	}
+
+	if(max_block_length == 0)
+	{
+		fprintf(stderr,
+			"%s: Host does not provide bufsz:maxBlockLength\n", descriptor->URI);
+		free(handle);
+		return NULL;
+	}
+
+	handle->max_block_length = max_block_length;
+	handle->nominal_block_length = (nominal_block_length > 0)
+		? nominal_block_length
+		: 0;
+
+	if(handle->log)
+	{
+		lv2_log_note(&handle->logger, "[%s] host blocks: %"PRIu32" nominal, "
+			"%"PRIu32" max, %s", __func__, handle->nominal_block_length,
+			handle->max_block_length,
+			handle->fixed_block_length ? "fixed" : "variable");
+	}
+
+	if(_buffers_init(handle) != 0)
+	{
+		_buffers_deinit(handle);
+		free(handle);
+		return NULL;
+	}
+
+	_fifo_reset(handle);
+
+	if(!props_init(&handle->props, descriptor->URI,
+		defs, MAX_NPROPS, &handle->state, &handle->stash,
+		handle->map, handle))
+	{
+		fprintf(stderr, "failed to initialize property structure\n");
+		free(handle);
+		return NULL;
+	}
+
+	handle->mephisto_code = props_map(&handle->props, MEPHISTO__code);
+	handle->mephisto_error = props_map(&handle->props, MEPHISTO__error);
+	handle->mephisto_timestamp = props_map(&handle->props, MEPHISTO__timestamp);
+	handle->mephisto_compileQueue = props_map(&handle->props, MEPHISTO__compileQueue);
+	handle->mephisto_compileOptions = props_map(&handle->props, MEPHISTO__compileOptions);
+	handle->mephisto_autoTune = props_map(&handle->props, MEPHISTO__autoTune);
+	handle->mephisto_tunedOptions = props_map(&handle->props, MEPHISTO__tunedOptions);
+	handle->mephisto_target = props_map(&handle->props, MEPHISTO__target);
+
+	handle->mephisto_stats[0] = props_map(&handle->props, MEPHISTO__compileTimeFactory);
+	handle->mephisto_stats[1] = props_map(&handle->props, MEPHISTO__compileTimeInstance);
+	handle->mephisto_stats[2] = props_map(&handle->props, MEPHISTO__compileTimeInit);
+	handle->mephisto_stats[3] = props_map(&handle->props, MEPHISTO__compileTimeClone);
+	handle->mephisto_stats[4] = props_map(&handle->props, MEPHISTO__compileTimeUi);
+	handle->mephisto_stats[5] = props_map(&handle->props, MEPHISTO__memoryFactory);
+	handle->mephisto_stats[6] = props_map(&handle->props, MEPHISTO__memoryInstances);
+
+	// default for sessions stored before compile options were introduced
+	_string_set(handle, handle->mephisto_compileOptions,
+		handle->state.compile_options, COMPILE_OPTIONS_DEFAULT);
+	props_stash(&handle->props, handle->mephisto_compileOptions);
+
+	handle->mephisto_silenceThreshold = props_map(&handle->props, MEPHISTO__silenceThreshold);
+	handle->mephisto_silenceBlocks = props_map(&handle->props, MEPHISTO__silenceBlocks);
+	handle->mephisto_parkedVoices = props_map(&handle->props, MEPHISTO__parkedVoices);
+	handle->mephisto_quantization = props_map(&handle->props, MEPHISTO__quantization);
+	handle->mephisto_blockLength = props_map(&handle->props, MEPHISTO__blockLength);
+	handle->mephisto_voiceThreads = props_map(&handle->props, MEPHISTO__voiceThreads);
+	handle->mephisto_voiceLoad = props_map(&handle->props, MEPHISTO__voiceLoad);
+	handle->mephisto_parallel = props_map(&handle->props, MEPHISTO__parallel);
+
+	// defaults for sessions stored before silent voices were parked
+	handle->state.silence_threshold = SILENCE_THRESHOLD_DEFAULT;
+	handle->state.silence_blocks = SILENCE_BLOCKS_DEFAULT;
+	handle->silence_level = powf(10.f, SILENCE_THRESHOLD_DEFAULT / 20.f);
+	props_stash(&handle->props, handle->mephisto_silenceThreshold);
+	props_stash(&handle->props, handle->mephisto_silenceBlocks);
+
+	handle->mephisto_control[0] = props_map(&handle->props, MEPHISTO__control_1);
+	handle->mephisto_control[1] = props_map(&handle->props, MEPHISTO__control_2);
+	handle->mephisto_control[2] = props_map(&handle->props, MEPHISTO__control_3);
+	handle->mephisto_control[3] = props_map(&handle->props, MEPHISTO__control_4);
+	handle->mephisto_control[4] = props_map(&handle->props, MEPHISTO__control_5);
+	handle->mephisto_control[5] = props_map(&handle->props, MEPHISTO__control_6);
+	handle->mephisto_control[6] = props_map(&handle->props, MEPHISTO__control_7);
+	handle->mephisto_control[7] = props_map(&handle->props, MEPHISTO__control_8);
+	handle->mephisto_control[8] = props_map(&handle->props, MEPHISTO__control_9);
+	handle->mephisto_control[9] = props_map(&handle->props, MEPHISTO__control_10);
+	handle->mephisto_control[10] = props_map(&handle->props, MEPHISTO__control_11);
+	handle->mephisto_control[11] = props_map(&handle->props, MEPHISTO__control_12);
+	handle->mephisto_control[12] = props_map(&handle->props, MEPHISTO__control_13);
+	handle->mephisto_control[13] = props_map(&handle->props, MEPHISTO__control_14);
+	handle->mephisto_control[14] = props_map(&handle->props, MEPHISTO__control_15);
+	handle->mephisto_control[15] = props_map(&handle->props, MEPHISTO__control_16);
+
+	handle->mephisto_controlMin[0] = props_map(&handle->props, MEPHISTO__controlMin_1);
+	handle->mephisto_controlMin[1] = props_map(&handle->props, MEPHISTO__controlMin_2);
+	handle->mephisto_controlMin[2] = props_map(&handle->props, MEPHISTO__controlMin_3);
+	handle->mephisto_controlMin[3] = props_map(&handle->props, MEPHISTO__controlMin_4);
+	handle->mephisto_controlMin[4] = props_map(&handle->props, MEPHISTO__controlMin_5);
+	handle->mephisto_controlMin[5] = props_map(&handle->props, MEPHISTO__controlMin_6);
+	handle->mephisto_controlMin[6] = props_map(&handle->props, MEPHISTO__controlMin_7);
+	handle->mephisto_controlMin[7] = props_map(&handle->props, MEPHISTO__controlMin_8);
+	handle->mephisto_controlMin[8] = props_map(&handle->props, MEPHISTO__controlMin_9);
+	handle->mephisto_controlMin[9] = props_map(&handle->props, MEPHISTO__controlMin_10);
+	handle->mephisto_controlMin[10] = props_map(&handle->props, MEPHISTO__controlMin_11);
+	handle->mephisto_controlMin[11] = props_map(&handle->props, MEPHISTO__controlMin_12);
+	handle->mephisto_controlMin[12] = props_map(&handle->props, MEPHISTO__controlMin_13);
+	handle->mephisto_controlMin[13] = props_map(&handle->props, MEPHISTO__controlMin_14);
+	handle->mephisto_controlMin[14] = props_map(&handle->props, MEPHISTO__controlMin_15);
+	handle->mephisto_controlMin[15] = props_map(&handle->props, MEPHISTO__controlMin_16);
+
+	handle->mephisto_controlMax[0] = props_map(&handle->props, MEPHISTO__controlMax_1);
+	handle->mephisto_controlMax[1] = props_map(&handle->props, MEPHISTO__controlMax_2);
+	handle->mephisto_controlMax[2] = props_map(&handle->props, MEPHISTO__controlMax_3);
+	handle->mephisto_controlMax[3] = props_map(&handle->props, MEPHISTO__controlMax_4);
+	handle->mephisto_controlMax[4] = props_map(&handle->props, MEPHISTO__controlMax_5);
+	handle->mephisto_controlMax[5] = props_map(&handle->props, MEPHISTO__controlMax_6);
+	handle->mephisto_controlMax[6] = props_map(&handle->props, MEPHISTO__controlMax_7);
+	handle->mephisto_controlMax[7] = props_map(&handle->props, MEPHISTO__controlMax_8);
+	handle->mephisto_controlMax[8] = props_map(&handle->props, MEPHISTO__controlMax_9);
+	handle->mephisto_controlMax[9] = props_map(&handle->props, MEPHISTO__controlMax_10);
+	handle->mephisto_controlMax[10] = props_map(&handle->props, MEPHISTO__controlMax_11);
+	handle->mephisto_controlMax[11] = props_map(&handle->props, MEPHISTO__controlMax_12);
+	handle->mephisto_controlMax[12] = props_map(&handle->props, MEPHISTO__controlMax_13);
+	handle->mephisto_controlMax[13] = props_map(&handle->props, MEPHISTO__controlMax_14);
+	handle->mephisto_controlMax[14] = props_map(&handle->props, MEPHISTO__controlMax_15);
+	handle->mephisto_controlMax[15] = props_map(&handle->props, MEPHISTO__controlMax_16);
+
+	handle->mephisto_controlStep[0] = props_map(&handle->props, MEPHISTO__controlStep_1);
+	handle->mephisto_controlStep[1] = props_map(&handle->props, MEPHISTO__controlStep_2);
+	handle->mephisto_controlStep[2] = props_map(&handle->props, MEPHISTO__controlStep_3);
+	handle->mephisto_controlStep[3] = props_map(&handle->props, MEPHISTO__controlStep_4);
+	handle->mephisto_controlStep[4] = props_map(&handle->props, MEPHISTO__controlStep_5);
+	handle->mephisto_controlStep[5] = props_map(&handle->props, MEPHISTO__controlStep_6);
+	handle->mephisto_controlStep[6] = props_map(&handle->props, MEPHISTO__controlStep_7);
+	handle->mephisto_controlStep[7] = props_map(&handle->props, MEPHISTO__controlStep_8);
+	handle->mephisto_controlStep[8] = props_map(&handle->props, MEPHISTO__controlStep_9);
+	handle->mephisto_controlStep[9] = props_map(&handle->props, MEPHISTO__controlStep_10);
+	handle->mephisto_controlStep[10] = props_map(&handle->props, MEPHISTO__controlStep_11);
 	handle->mephisto_controlStep[11] = props_map(&handle->props, MEPHISTO__controlStep_12);
 	handle->mephisto_controlStep[12] = props_map(&handle->props, MEPHISTO__controlStep_13);
 	handle->mephisto_controlStep[13] = props_map(&handle->props, MEPHISTO__controlStep_14);
 	handle->mephisto_controlStep[14] = props_map(&handle->props, MEPHISTO__controlStep_15);
 	handle->mephisto_controlStep[15] = props_map(&handle->props, MEPHISTO__controlStep_16);
 
-	handle->mephisto_controlType[0] = props_map(&handle->props, MEPHISTO__controlType_1);
-	handle->mephisto_controlType[1] = props_map(&handle->props, MEPHISTO__controlType_2);
-	handle->mephisto_controlType[2] = props_map(&handle->props, MEPHISTO__controlType_3);
-	handle->mephisto_controlType[3] = props_map(&handle->props, MEPHISTO__controlType_4);
-	handle->mephisto_controlType[4] = props_map(&handle->props, MEPHISTO__controlType_5);
-	handle->mephisto_controlType[5] = props_map(&handle->props, MEPHISTO__controlType_6);
-	handle->mephisto_controlType[6] = props_map(&handle->props, MEPHISTO__controlType_7);
-	handle->mephisto_controlType[7] = props_map(&handle->props, MEPHISTO__controlType_8);
-	handle->mephisto_controlType[8] = props_map(&handle->props, MEPHISTO__controlType_9);
-	handle->mephisto_controlType[9] = props_map(&handle->props, MEPHISTO__controlType_10);
-	handle->mephisto_controlType[10] = props_map(&handle->props, MEPHISTO__controlType_11);
-	handle->mephisto_controlType[11] = props_map(&handle->props, MEPHISTO__controlType_12);
-	handle->mephisto_controlType[12] = props_map(&handle->props, MEPHISTO__controlType_13);
-	handle->mephisto_controlType[13] = props_map(&handle->props, MEPHISTO__controlType_14);
-	handle->mephisto_controlType[14] = props_map(&handle->props, MEPHISTO__controlType_15);
-	handle->mephisto_controlType[15] = props_map(&handle->props, MEPHISTO__controlType_16);
+	handle->mephisto_controlType[0] = props_map(&handle->props, MEPHISTO__controlType_1);
+	handle->mephisto_controlType[1] = props_map(&handle->props, MEPHISTO__controlType_2);
+	handle->mephisto_controlType[2] = props_map(&handle->props, MEPHISTO__controlType_3);
+	handle->mephisto_controlType[3] = props_map(&handle->props, MEPHISTO__controlType_4);
+	handle->mephisto_controlType[4] = props_map(&handle->props, MEPHISTO__controlType_5);
+	handle->mephisto_controlType[5] = props_map(&handle->props, MEPHISTO__controlType_6);
+	handle->mephisto_controlType[6] = props_map(&handle->props, MEPHISTO__controlType_7);
+	handle->mephisto_controlType[7] = props_map(&handle->props, MEPHISTO__controlType_8);
+	handle->mephisto_controlType[8] = props_map(&handle->props, MEPHISTO__controlType_9);
+	handle->mephisto_controlType[9] = props_map(&handle->props, MEPHISTO__controlType_10);
+	handle->mephisto_controlType[10] = props_map(&handle->props, MEPHISTO__controlType_11);
+	handle->mephisto_controlType[11] = props_map(&handle->props, MEPHISTO__controlType_12);
+	handle->mephisto_controlType[12] = props_map(&handle->props, MEPHISTO__controlType_13);
+	handle->mephisto_controlType[13] = props_map(&handle->props, MEPHISTO__controlType_14);
+	handle->mephisto_controlType[14] = props_map(&handle->props, MEPHISTO__controlType_15);
+	handle->mephisto_controlType[15] = props_map(&handle->props, MEPHISTO__controlType_16);
+
+	handle->mephisto_controlLabel[0] = props_map(&handle->props, MEPHISTO__controlLabel_1);
+	handle->mephisto_controlLabel[1] = props_map(&handle->props, MEPHISTO__controlLabel_2);
+	handle->mephisto_controlLabel[2] = props_map(&handle->props, MEPHISTO__controlLabel_3);
+	handle->mephisto_controlLabel[3] = props_map(&handle->props, MEPHISTO__controlLabel_4);
+	handle->mephisto_controlLabel[4] = props_map(&handle->props, MEPHISTO__controlLabel_5);
+	handle->mephisto_controlLabel[5] = props_map(&handle->props, MEPHISTO__controlLabel_6);
+	handle->mephisto_controlLabel[6] = props_map(&handle->props, MEPHISTO__controlLabel_7);
+	handle->mephisto_controlLabel[7] = props_map(&handle->props, MEPHISTO__controlLabel_8);
+	handle->mephisto_controlLabel[8] = props_map(&handle->props, MEPHISTO__controlLabel_9);
+	handle->mephisto_controlLabel[9] = props_map(&handle->props, MEPHISTO__controlLabel_10);
+	handle->mephisto_controlLabel[10] = props_map(&handle->props, MEPHISTO__controlLabel_11);
+	handle->mephisto_controlLabel[11] = props_map(&handle->props, MEPHISTO__controlLabel_12);
+	handle->mephisto_controlLabel[12] = props_map(&handle->props, MEPHISTO__controlLabel_13);
+	handle->mephisto_controlLabel[13] = props_map(&handle->props, MEPHISTO__controlLabel_14);
+	handle->mephisto_controlLabel[14] = props_map(&handle->props, MEPHISTO__controlLabel_15);
+	handle->mephisto_controlLabel[15] = props_map(&handle->props, MEPHISTO__controlLabel_16);
+
+	handle->to_worker = varchunk_new(BUF_SIZE, true);
+	handle->srate = rate;
+
+	for(uint32_t chn = 0; chn < 0x10; chn++)
+	{
+		handle->range[chn] = 48.f; // semitones
+		handle->bend_factor[chn] = 1.f;
+		handle->manager[chn] = ZONE_NONE;
+	}
+
+	handle->zones[0].manager = 0x0;
+	handle->zones[1].manager = 0xf;
+
+	handle->tuning = malloc(sizeof(tuning_t));
+	if(!handle->tuning)
+	{
+		varchunk_free(handle->to_worker);
+		_buffers_deinit(handle);
+		free(handle);
+		return NULL;
+	}
+
+	_tuning_reset(handle->tuning);
+	_tuning_reset(&handle->tuning_edit);
+
+	const timely_mask_t mask = 0;
+	timely_init(&handle->timely, handle->map, rate, mask, _timely_cb, handle);
+	timely_set_multiplier(&handle->timely, 1.f);
+
+	return handle;
+}
+
+static void
+connect_port(LV2_Handle instance, uint32_t port, void *data)
+{
+	plughandle_t *handle = (plughandle_t *)instance;
+
+	// the latency port follows the audio/cv ports of all variants
+	if(port == 2 + 2*handle->nchannel)
+	{
+		handle->latency = (float *)data;
+
+		return;
+	}
+
+	switch(port)
+	{
+		case 0:
+			handle->control = (const LV2_Atom_Sequence *)data;
+			break;
+		case 1:
+			handle->notify = (LV2_Atom_Sequence *)data;
+			break;
+
+		case 2:
+			handle->audio_in[0] = (const float *)data;
+			break;
+		case 3:
+			handle->audio_out[0] = (float *)data;
+			break;
+
+		case 4:
+			handle->audio_in[1] = (const float *)data;
+			break;
+		case 5:
+			handle->audio_out[1] = (float *)data;
+			break;
+
+		case 6:
+			handle->audio_in[2] = (const float *)data;
+			break;
+		case 7:
+			handle->audio_out[2] = (float *)data;
+			break;
+
+		case 8:
+			handle->audio_in[3] = (const float *)data;
+			break;
+		case 9:
+			handle->audio_out[3] = (float *)data;
+			break;
+
+		case 10:
+			handle->audio_in[4] = (const float *)data;
+			break;
+		case 11:
+			handle->audio_out[4] = (float *)data;
+			break;
+
+		case 12:
+			handle->audio_in[5] = (const float *)data;
+			break;
+		case 13:
+			handle->audio_out[5] = (float *)data;
+			break;
+
+		case 14:
+			handle->audio_in[6] = (const float *)data;
+			break;
+		case 15:
+			handle->audio_out[6] = (float *)data;
+			break;
+
+		case 16:
+			handle->audio_in[7] = (const float *)data;
+			break;
+		case 17:
+			handle->audio_out[7] = (float *)data;
+			break;
+
+		default:
+			break;
+	}
+}
+
+// e.g. after voice states were copied over from another dsp
+static inline void
+_voice_map_rebuild(dsp_t *dsp)
+{
+	_voice_unmap_all(dsp);
+
+	VOICE_FOREACH(dsp, voice)
+	{
+		if(voice->state == VOICE_STATE_ACTIVE)
+		{
+			_voice_map(dsp, voice);
+		}
+	}
+}
+
+static inline voice_t *
+_find_active_voice(dsp_t *dsp, const hash_t *hash)
+{
+	const uint8_t slot = *_voice_slot(dsp, hash);
+
+	return slot
+		? &dsp->voices[slot - 1]
+		: NULL;
+}
+
+// sustained voices are stolen first, oldest first
+static inline voice_t *
+_voice_steal_oldest(dsp_t *dsp)
+{
+	VOICE_LIST_FOREACH(&dsp->busy, LIST_STATE, voice)
+	{
+		if(voice->state & VOICE_STATE_SUSTAIN)
+		{
+			return voice;
+		}
+	}
+
+	return dsp->busy.head;
+}
+
+static inline voice_t *
+_voice_steal_quietest(dsp_t *dsp)
+{
+	voice_t *quietest = dsp->busy.head;
+
+	VOICE_LIST_FOREACH(&dsp->busy, LIST_STATE, voice)
+	{
+		if(voice->peak < quietest->peak)
+		{
+			quietest = voice;
+		}
+	}
+
+	return quietest;
+}
+
+// the voice still playing the same key, held or sustained
+static inline voice_t *
+_voice_same_key(dsp_t *dsp, const hash_t *hash)
+{
+	voice_t *held = _find_active_voice(dsp, hash);
+
+	if(held)
+	{
+		return held;
+	}
+
+	VOICE_LIST_FOREACH(&dsp->channel[hash->chn & 0x0f], LIST_CHANNEL, voice)
+	{
+		if(voice->hash.key == hash->key)
+		{
+			return voice;
+		}
+	}
+
+	return NULL;
+}
+
+// the longest idle voice, or a busy one according to the stealing policy
+static inline voice_t *
+_voice_allocate(dsp_t *dsp, const hash_t *hash)
+{
+	if(dsp->steal == STEAL_SAMEKEY)
+	{
+		voice_t *voice = _voice_same_key(dsp, hash);
+
+		if(voice)
+		{
+			return voice;
+		}
+	}
+
+	if(dsp->idle.head)
+	{
+		return dsp->idle.head;
+	}
+
+	switch(dsp->steal)
+	{
+		case STEAL_QUIETEST:
+			return _voice_steal_quietest(dsp);
+		case STEAL_OLDEST:
+			// fall-through
+		case STEAL_SAMEKEY:
+			break;
+	}
+
+	return _voice_steal_oldest(dsp);
+}
+
+static inline const zone_t *
+_zone_managed(plughandle_t *handle, uint8_t chn)
+{
+	for(unsigned z = 0; z < 2; z++)
+	{
+		const zone_t *zone = &handle->zones[z];
+
+		if( (zone->manager == chn) && (zone->members > 0) )
+		{
+			return zone;
+		}
+	}
+
+	return NULL;
+}
+
+static inline uint8_t
+_zone_member(const zone_t *zone, uint8_t i)
+{
+	return (zone->manager == 0x0)
+		? 0x1 + i
+		: 0xe - i;
+}
+
+// the channel itself, plus all member channels if it manages an MPE zone
+static inline uint32_t
+_zone_channels(plughandle_t *handle, uint8_t chn, uint8_t chns [0x10])
+{
+	const zone_t *zone = _zone_managed(handle, chn);
+	uint32_t nchns = 0;
+
+	chns[nchns++] = chn;
+
+	if(zone)
+	{
+		for(uint8_t i = 0; i < zone->members; i++)
+		{
+			chns[nchns++] = _zone_member(zone, i);
+		}
+	}
+
+	return nchns;
+}
+
+static inline void
+_zone_update(plughandle_t *handle)
+{
+	memset(handle->manager, ZONE_NONE, sizeof(handle->manager));
+
+	for(unsigned z = 0; z < 2; z++)
+	{
+		const zone_t *zone = &handle->zones[z];
+
+		for(uint8_t i = 0; i < zone->members; i++)
+		{
+			handle->manager[_zone_member(zone, i)] = zone->manager;
+		}
+	}
+}
+
+// bend scales the frequency of all keys on a channel alike
+static inline void
+_update_bend_factor(plughandle_t *handle, uint8_t chn)
+{
+	handle->bend_factor[chn] = _semi2factor(handle->bend[chn]
+		* handle->range[chn]);
+}
+
+// member channels additionally follow the bend of their manager channel
+static inline float
+_channel_factor(plughandle_t *handle, uint8_t chn)
+{
+	const uint8_t manager = handle->manager[chn];
+
+	return (manager != ZONE_NONE)
+		? handle->bend_factor[chn] * handle->bend_factor[manager]
+		: handle->bend_factor[chn];
+}
+
+static inline bool
+_channel_sustain(plughandle_t *handle, uint8_t chn)
+{
+	const uint8_t manager = handle->manager[chn];
+
+	return (manager != ZONE_NONE)
+		? handle->sustain[chn] || handle->sustain[manager]
+		: handle->sustain[chn];
+}
+
+static inline void
+_update_frequency_channel(plughandle_t *handle, dsp_t *dsp, uint8_t chn)
+{
+	const float *key_freqs = handle->tuning->freq[chn];
+	const float factor = _channel_factor(handle, chn);
+
+	VOICE_LIST_FOREACH(&dsp->channel[chn], LIST_CHANNEL, voice)
+	{
+		if(voice->state & VOICE_STATE_ACTIVE)
+		{
+			const float freq = key_freqs[voice->hash.key & 0x7f] * factor;
+
+			_cntrl_refresh_value_abs(&voice->freq, freq);
+		}
+	}
+}
+
+static inline void
+_update_frequency(plughandle_t *handle, dsp_t *dsp, uint8_t chn)
+{
+	uint8_t chns [0x10];
+	const uint32_t nchns = _zone_channels(handle, chn, chns);
+
+	for(uint32_t c = 0; c < nchns; c++)
+	{
+		_update_frequency_channel(handle, dsp, chns[c]);
+	}
+}
+
+static inline void
+_update_pressure(plughandle_t *handle, dsp_t *dsp, uint8_t chn)
+{
+	const float pressure = handle->pressure[chn] * 0x1p-14;
+	uint8_t chns [0x10];
+	const uint32_t nchns = _zone_channels(handle, chn, chns);
+
+	for(uint32_t c = 0; c < nchns; c++)
+	{
+		VOICE_LIST_FOREACH(&dsp->channel[chns[c]], LIST_CHANNEL, voice)
+		{
+			if(voice->state & VOICE_STATE_ACTIVE)
+			{
+				_cntrl_refresh_value_abs(&voice->pressure, pressure);
+			}
+		}
+	}
+}
+
+static inline void
+_update_timbre(plughandle_t *handle, dsp_t *dsp, uint8_t chn)
+{
+	const float timbre = handle->timbre[chn] * 0x1p-14;
+	uint8_t chns [0x10];
+	const uint32_t nchns = _zone_channels(handle, chn, chns);
+
+	for(uint32_t c = 0; c < nchns; c++)
+	{
+		VOICE_LIST_FOREACH(&dsp->channel[chns[c]], LIST_CHANNEL, voice)
+		{
+			if(voice->state & VOICE_STATE_ACTIVE)
+			{
+				_cntrl_refresh_value_abs(&voice->timbre, timbre);
+			}
+		}
+	}
+}
+
+static inline void
+_voice_off(plughandle_t *handle, dsp_t *dsp, voice_t *voice)
+{
+	if(_channel_sustain(handle, voice->hash.chn))
+	{
+		voice->state |= VOICE_STATE_SUSTAIN;
+	}
+	else
+	{
+		_cntrl_refresh_value_abs(&voice->gate, 0.f);
+
+		_voice_move(dsp, voice, VOICE_STATE_INACTIVE);
+	}
+}
+
+static inline void
+_voice_off_panic(dsp_t *dsp, voice_t *voice)
+{
+	_cntrl_refresh_value_abs(&voice->gate, 0.f);
+
+	if(voice->state != VOICE_STATE_INACTIVE)
+	{
+		_voice_move(dsp, voice, VOICE_STATE_INACTIVE);
+	}
+}
+
+static inline void
+_voice_off_force(dsp_t *dsp, voice_t *voice)
+{
+	_cntrl_refresh_value_abs(&voice->gate, 0.f);
+
+	if(voice->state != VOICE_STATE_INACTIVE)
+	{
+		_voice_move(dsp, voice, VOICE_STATE_INACTIVE);
+	}
+}
+
+// rt-thread, releases a held note still waiting for its voice
+static inline void
+_carry_off(plughandle_t *handle, dsp_t *dsp, const hash_t *hash)
+{
+	for(uint32_t i = dsp->icarry; i < dsp->ncarry; i++)
+	{
+		carry_t *carry = &dsp->carry[i];
+
+		if( (carry->state != VOICE_STATE_ACTIVE) || (carry->hash.id != hash->id) )
+		{
+			continue;
+		}
+
+		if(_channel_sustain(handle, carry->hash.chn))
+		{
+			carry->state |= VOICE_STATE_SUSTAIN;
+		}
+		else
+		{
+			carry->state = VOICE_STATE_INACTIVE;
+		}
+	}
+}
+
+// rt-thread, sustained notes waiting for their voice on released channels
+static inline void
+_carry_sustain_off(plughandle_t *handle, dsp_t *dsp)
+{
+	for(uint32_t i = dsp->icarry; i < dsp->ncarry; i++)
+	{
+		carry_t *carry = &dsp->carry[i];
+
+		if( (carry->state & VOICE_STATE_SUSTAIN)
+			&& !_channel_sustain(handle, carry->hash.chn) )
+		{
+			carry->state = VOICE_STATE_INACTIVE;
+		}
+	}
+}
+
+// the other zone shrinks if both would overlap, bend ranges are reset
+static void
+_zone_configure(plughandle_t *handle, dsp_t *dsp, uint8_t chn, uint8_t members)
+{
+	zone_t *zone = &handle->zones[chn == 0x0 ? 0 : 1];
+	zone_t *other = &handle->zones[chn == 0x0 ? 1 : 0];
+
+	zone->members = (members < 0xf)
+		? members
+		: 0xf;
+
+	if(zone->members + other->members > 0xe)
+	{
+		other->members = (zone->members < 0xe)
+			? 0xe - zone->members
+			: 0;
+	}
+
+	_zone_update(handle);
+
+	for(uint8_t c = 0; c < 0x10; c++)
+	{
+		if(c == zone->manager)
+		{
+			handle->range[c] = ZONE_RANGE_MANAGER;
+		}
+		else if(handle->manager[c] == zone->manager)
+		{
+			handle->range[c] = ZONE_RANGE_MEMBER;
+		}
+		else
+		{
+			continue;
+		}
+
+		_update_bend_factor(handle, c);
+	}
+
+	// former members may have left a zone, too
+	for(uint8_t c = 0; c < 0x10; c++)
+	{
+		_update_frequency_channel(handle, dsp, c);
+	}
+}
+
+static void
+_handle_midi_2(plughandle_t *handle, dsp_t *dsp,
+	int64_t frames __attribute__((unused)), const uint8_t *msg)
+{
+	const uint8_t cmd = msg[0] & 0xf0;
+	const uint8_t chn = msg[0] & 0x0f;
+
+	if(!dsp || !dsp->is_instrument || !dsp->midi_on)
+	{
+		return;
+	}
+
+	switch(cmd)
+	{
+		case LV2_MIDI_MSG_CONTROLLER:
+		{
+			const uint8_t ctr = msg[1];
+
+			switch(ctr)
+			{
+				case LV2_MIDI_CTL_ALL_NOTES_OFF:
+				{
+					VOICE_FOREACH(dsp, voice)
+					{
+						_voice_off_panic(dsp, voice);
+					}
+
+					_voice_unmap_all(dsp);
+					dsp->icarry = dsp->ncarry;
+				} break;
+				case LV2_MIDI_CTL_ALL_SOUNDS_OFF:
+				{
+					VOICE_FOREACH(dsp, voice)
+					{
+						_voice_off_force(dsp, voice);
+					}
+
+					_voice_unmap_all(dsp);
+					dsp->icarry = dsp->ncarry;
+				} break;
+			}
+		} break;
+		case LV2_MIDI_MSG_CHANNEL_PRESSURE:
+		{
+			const uint8_t pre = msg[1];
+
+			handle->pressure[chn] = pre << 7;
+
+			_update_pressure(handle, dsp, chn);
+		} break;
+	}
+}
+
+static void
+_handle_midi_3(plughandle_t *handle, dsp_t *dsp,
+	int64_t frames __attribute__((unused)), const uint8_t *msg)
+{
+	const uint8_t cmd = msg[0] & 0xf0;
+	const uint8_t chn = msg[0] & 0x0f;
+
+	if(!dsp || !dsp->is_instrument || !dsp->midi_on)
+	{
+		return;
+	}
+
+	switch(cmd)
+	{
+		case LV2_MIDI_MSG_NOTE_ON:
+		{
+			const uint8_t key = msg[1];
+			const uint8_t vel = msg[2];
+
+			const hash_t hash = {
+				.key= key,
+				.chn = chn
+			};
+
+			// release a note still held on the same key, it could not be found
+			// for its note-off any more, unless it is to be retriggered anyways
+			voice_t *held = (dsp->steal != STEAL_SAMEKEY)
+				? _find_active_voice(dsp, &hash)
+				: NULL;
+
+			if(held)
+			{
+				_voice_unmap(dsp, held);
+				_voice_off(handle, dsp, held);
+			}
+
+			_carry_off(handle, dsp, &hash);
+
+			voice_t *voice = _voice_allocate(dsp, &hash);
+			if(voice)
+			{
+				// a stolen voice no longer plays its previous note
+				if(voice->state == VOICE_STATE_ACTIVE)
+				{
+					_voice_unmap(dsp, voice);
+				}
+
+				const float freq = handle->tuning->freq[chn][key & 0x7f]
+					* _channel_factor(handle, chn);
+
+				_cntrl_refresh_value_abs(&voice->freq, freq);
+				_cntrl_refresh_value_abs(&voice->gain, vel * 0x1p-7);
+				_cntrl_refresh_value_abs(&voice->gate, 0.f);
+
+				_voice_unlist(dsp, voice);
+				voice->hash.key = key;
+				voice->hash.chn = chn;
+				voice->state = VOICE_STATE_ACTIVE;
+				_voice_enlist(dsp, voice);
+				voice->retrigger = true;
+				voice->parked = false;
+				voice->silent = 0;
+				voice->peak = FLT_MAX; // not to be stolen as quietest before rendered
+
+				_voice_map(dsp, voice);
+			}
+		} break;
+		case LV2_MIDI_MSG_NOTE_OFF:
+		{
+			const uint8_t key = msg[1];
+
+			const hash_t hash = {
+				.key= key,
+				.chn = chn
+			};
+
+			voice_t *voice = _find_active_voice(dsp, &hash);
+
+			if(voice)
+			{
+				_voice_unmap(dsp, voice);
+				_voice_off(handle, dsp, voice);
+			}
+			else
+			{
+				_carry_off(handle, dsp, &hash);
+			}
+		} break;
+		case LV2_MIDI_MSG_NOTE_PRESSURE:
+		{
+			const uint8_t key = msg[1];
+			const uint8_t pre = msg[2];
+
+			const hash_t hash = {
+				.key= key,
+				.chn = chn
+			};
+
+			voice_t *voice = _find_active_voice(dsp, &hash);
+
+			if(voice)
+			{
+				_cntrl_refresh_value_abs(&voice->pressure, pre * 0x1p-7);
+			}
+		} break;
+		case LV2_MIDI_MSG_BENDER:
+		{
+			const uint8_t lsb = msg[1];
+			const uint8_t msb = msg[2];
+			const int16_t bend = (msb << 7) | lsb;
+
+			handle->bend[chn] = (bend - 0x2000) * 0x1p-13;
+			_update_bend_factor(handle, chn);
+			_update_frequency(handle, dsp, chn);
+		} break;
+		case LV2_MIDI_MSG_CONTROLLER:
+		{
+			const uint8_t ctr = msg[1];
+			const uint8_t val = msg[2];
+
+			switch(ctr)
+			{
+				case LV2_MIDI_CTL_SUSTAIN:
+				{
+					handle->sustain[chn] = (val > 0x3f)
+						? true
+						: false;
+
+					if(handle->sustain[chn] == false)
+					{
+						uint8_t chns [0x10];
+						const uint32_t nchns = _zone_channels(handle, chn, chns);
+
+						for(uint32_t c = 0; c < nchns; c++)
+						{
+							if(_channel_sustain(handle, chns[c]))
+							{
+								continue;
+							}
+
+							voice_t *next;
+
+							// released voices leave the channel's list
+							for(voice_t *voice = dsp->channel[chns[c]].head; voice; voice = next)
+							{
+								next = voice->links[LIST_CHANNEL].next;
+
+								if(voice->state & VOICE_STATE_SUSTAIN)
+								{
+									_voice_off(handle, dsp, voice);
+								}
+							}
+						}
+
+						_carry_sustain_off(handle, dsp);
+					}
+				} break;
+				case LV2_MIDI_CTL_RPN_LSB:
+				{
+					handle->rpn_lsb[chn] = val;
+				} break;
+				case LV2_MIDI_CTL_RPN_MSB:
+				{
+					handle->rpn_msb[chn] = val;
+				} break;
+				case LV2_MIDI_CTL_LSB_DATA_ENTRY:
+				{
+					handle->data_lsb[chn] = val;
+				} break;
+				case LV2_MIDI_CTL_MSB_DATA_ENTRY:
+				{
+					// pitch-bend range
+					if( (handle->rpn_msb[chn] == 0x0) && (handle->rpn_lsb[chn] == 0x0) )
+					{
+						const uint8_t semi = val;
+						const uint8_t cent = handle->data_lsb[chn];
+
+						handle->range[chn] = (float)semi + cent*0.01f;
+						_update_bend_factor(handle, chn);
+						_update_frequency(handle, dsp, chn);
+					}
+					// MPE configuration message
+					else if( (handle->rpn_msb[chn] == 0x0) && (handle->rpn_lsb[chn] == 0x6)
+						&& ( (chn == 0x0) || (chn == 0xf) ) )
+					{
+						_zone_configure(handle, dsp, chn, val);
+					}
+				} break;
+
+				case LV2_MIDI_CTL_SC1_SOUND_VARIATION | 0x20:
+				{
+					handle->pressure[chn] &= 0x7f;
+					handle->pressure[chn] |= val;
+				} break;
+				case LV2_MIDI_CTL_SC1_SOUND_VARIATION:
+				{
+					handle->pressure[chn] &= 0x3f80;
+					handle->pressure[chn] |= val << 7;
+
+					_update_pressure(handle, dsp, chn);
+				} break;
+				case LV2_MIDI_CTL_SC5_BRIGHTNESS | 0x20:
+				{
+					handle->timbre[chn] &= 0x7f;
+					handle->timbre[chn] |= val;
+				} break;
+				case LV2_MIDI_CTL_SC5_BRIGHTNESS:
+				{
+					handle->timbre[chn] &= 0x3f80;
+					handle->timbre[chn] |= val << 7;
+
+					_update_timbre(handle, dsp, chn);
+				} break;
+			}
+		} break;
+	}
+}
+
+// MIDI tuning standard, non-realtime or realtime universal system exclusive
+static inline bool
+_mts_check(const uint8_t *msg, uint32_t len)
+{
+	return (len >= 6)
+		&& (msg[0] == LV2_MIDI_MSG_SYSTEM_EXCLUSIVE)
+		&& ( (msg[1] == 0x7e) || (msg[1] == 0x7f) )
+		&& (msg[3] == 0x08)
+		&& (msg[len - 1] == 0xf7); // end of exclusive
+}
+
+static void
+_handle_midi(plughandle_t *handle, dsp_t *dsp,
+	int64_t frames, const uint8_t *msg, uint32_t len)
+{
+	switch(len)
+	{
+		case 2:
+		{
+			_handle_midi_2(handle, dsp, frames, msg);
+		} break;
+		case 3:
+		{
+			_handle_midi_3(handle, dsp, frames, msg);
+		} break;
+	}
+}
+
+// rt-thread, e.g. held notes from one dsp to the next
+static inline void
+_voice_copy(voice_t *dst, voice_t *src)
+{
+	_cntrl_refresh_value_abs(&dst->freq, _cntrl_get_value_abs(&src->freq));
+	_cntrl_refresh_value_abs(&dst->pressure,
+		_cntrl_get_value_abs(&src->pressure));
+	_cntrl_refresh_value_abs(&dst->timbre, _cntrl_get_value_abs(&src->timbre));
+	_cntrl_refresh_value_abs(&dst->d_freq, _cntrl_get_value_abs(&src->d_freq));
+	_cntrl_refresh_value_abs(&dst->d_pressure,
+		_cntrl_get_value_abs(&src->d_pressure));
+	_cntrl_refresh_value_abs(&dst->d_timbre,
+		_cntrl_get_value_abs(&src->d_timbre));
+	_cntrl_refresh_value_abs(&dst->gate, _cntrl_get_value_abs(&src->gate));
+	_cntrl_refresh_value_abs(&dst->gain, _cntrl_get_value_abs(&src->gain));
+
+	dst->state = src->state;
+	dst->hash = src->hash;
+	dst->peak = src->peak;
+}
+
+static inline void
+_carry_save(carry_t *carry, voice_t *voice)
+{
+	carry->hash = voice->hash;
+	carry->state = voice->state;
+	carry->gate = _cntrl_get_value_abs(&voice->gate);
+	carry->gain = _cntrl_get_value_abs(&voice->gain);
+	carry->freq = _cntrl_get_value_abs(&voice->freq);
+	carry->pressure = _cntrl_get_value_abs(&voice->pressure);
+	carry->timbre = _cntrl_get_value_abs(&voice->timbre);
+	carry->d_freq = _cntrl_get_value_abs(&voice->d_freq);
+	carry->d_pressure = _cntrl_get_value_abs(&voice->d_pressure);
+	carry->d_timbre = _cntrl_get_value_abs(&voice->d_timbre);
+}
+
+static void
+_dsp_install(plughandle_t *handle, dsp_t *dsp)
+{
+	const job_t job = {
+		.type = JOB_TYPE_DEINIT,
+		.dsp = handle->dsp[!handle->play]
+	};
+	handle->sched->schedule_work(handle->sched->handle, sizeof(job), &job);
+
+	handle->dsp[!handle->play] = dsp;
+	handle->xfade_cur = handle->xfade_max;
+
+	_string_set(handle, handle->mephisto_target, handle->state.target,
+		dsp->machine);
+	handle->dirty.target = true;
+
+	handle->state.time_factory = dsp->stats.factory * 1e-6f;
+	handle->state.time_instance = dsp->stats.instance * 1e-6f;
+	handle->state.time_init = dsp->stats.init * 1e-6f;
+	handle->state.time_clone = dsp->stats.clone * 1e-6f;
+	handle->state.time_ui = dsp->stats.ui * 1e-6f;
+	handle->state.memory_factory = dsp->stats.memory_factory;
+	handle->state.memory_instances = dsp->stats.memory_instances;
+	handle->dirty.stats = true;
+
+	for(uint32_t i = 0; i < NCONTROLS; i++)
+	{
+		_refresh_value(handle, i);
+		_refresh_attributes(handle, i);
+	}
+
+	dsp_t *cur_dsp = handle->dsp[handle->play];
+	dsp_t *new_dsp = handle->dsp[!handle->play];
+
+	if(cur_dsp && new_dsp && cur_dsp->is_instrument && new_dsp->is_instrument)
+	{
+		voice_t *new_voice = _voice_begin(new_dsp);
+
+		new_dsp->icarry = 0;
+		new_dsp->ncarry = 0;
+
+		// held notes, oldest first, those beyond the voices ready are carried
+		// over as soon as the worker published more
+		VOICE_LIST_FOREACH(&cur_dsp->busy, LIST_STATE, cur_voice)
+		{
+			if(_voice_not_end(new_dsp, new_voice))
+			{
+				_voice_copy(new_voice, cur_voice);
+
+				new_voice = _voice_next(new_voice);
+			}
+			else
+			{
+				_carry_save(&new_dsp->carry[new_dsp->ncarry++], cur_voice);
+			}
+		}
+
+		_voice_map_rebuild(new_dsp);
+	}
+
+	_voice_lists_rebuild(dsp);
+
+	handle->dirty.attributes = true;
+}
+
+// rt-thread, a crossfade in progress is never cut short, e.g. by the JIT
+// compiled dsp following its interpreted one shortly, the latest dsp is held
+// back until then, superseded ones are freed right away
+static void
+_dsp_offer(plughandle_t *handle, dsp_t *dsp)
+{
+	if(handle->held_dsp)
+	{
+		const job_t job = {
+			.type = JOB_TYPE_DEINIT,
+			.dsp = handle->held_dsp
+		};
+		handle->sched->schedule_work(handle->sched->handle, sizeof(job), &job);
+
+		handle->held_dsp = NULL;
+	}
+
+	if(handle->xfade_cur > 0)
+	{
+		handle->held_dsp = dsp;
+	}
+	else
+	{
+		_dsp_install(handle, dsp);
+	}
+}
+
+// reports the time each voice thread spent rendering, relative to real time,
+// about once a second
+static inline void
+_voice_pool_load(plughandle_t *handle, uint32_t nsamples)
+{
+	voice_pool_t *vpool = handle->pool;
+	const uint32_t nlanes = pool_lanes(vpool->pool);
+
+	for(uint32_t l = 0; l < nlanes; l++)
+	{
+		handle->pool_busy[l] += pool_busy(vpool->pool, l);
+	}
+
+	handle->pool_frames += nsamples;
+
+	if(handle->pool_frames < handle->srate)
+	{
+		return;
+	}
+
+	const double real = 1e9 * handle->pool_frames / handle->srate; // ns
+	char load [LOAD_SIZE];
+	size_t len = 0;
+
+	load[0] = '\0';
+
+	for(uint32_t l = 0; (l < nlanes) && (len < sizeof(load)); l++)
+	{
+		len += snprintf(&load[len], sizeof(load) - len, "%s%.0f%%",
+			l ? " " : "", 100.0 * handle->pool_busy[l] / real);
+
+		handle->pool_busy[l] = 0;
+	}
+
+	_string_set(handle, handle->mephisto_voiceLoad, handle->state.voice_load,
+		load);
+
+	handle->pool_frames = 0;
+	handle->dirty.load = true;
+}
+
+// floors event times to the quantization grid, relative to the block start
+static inline int64_t
+_quantize(plughandle_t *handle, int64_t frames)
+{
+	int64_t grid = handle->state.quantization;
+
+	// keeps internal blocks whole when rendering without fifo
+	if(handle->state.block_length && !handle->fifo_latency)
+	{
+		const int64_t block = handle->state.block_length;
+
+		grid = (grid > block)
+			? (grid + block - 1) / block * block
+			: block;
+	}
+
+	if(grid <= 1)
+	{
+		return frames;
+	}
+
+	return frames - frames % grid;
+}
+
+static void
+run(LV2_Handle instance, uint32_t nsamples)
+{
+	plughandle_t *handle = instance;
+
+	const uint32_t capacity = handle->notify->atom.size;
+	LV2_Atom_Forge_Frame frame;
+	lv2_atom_forge_set_buffer(&handle->forge, (uint8_t *)handle->notify, capacity);
+	handle->ref = lv2_atom_forge_sequence_head(&handle->forge, &frame, 0);
+
+	// the crossfade has finished with the previous cycle
+	if(handle->held_dsp && (handle->xfade_cur == 0) )
+	{
+		dsp_t *held_dsp = handle->held_dsp;
+
+		handle->held_dsp = NULL;
+		_dsp_install(handle, held_dsp);
+	}
+
+	dsp_t *restored_dsp = atomic_exchange_explicit(&handle->restored_dsp, NULL,
+		memory_order_acquire);
+	if(restored_dsp)
+	{
+		_dsp_offer(handle, restored_dsp);
+
+		// do not submit the restored code to the worker once more
+		handle->skip_submit = true;
+	}
+
+	handle->idling = true;
+	props_idle(&handle->props, &handle->forge, 0, &handle->ref);
+	handle->idling = false;
+
+	if(handle->skipped_submit)
+	{
+		handle->skip_submit = false;
+		handle->skipped_submit = false;
+	}
+
+	for(uint32_t d = 0; d < 2; d++)
+	{
+		dsp_t *dsp = handle->dsp[d];
+
+		if(dsp)
+		{
+			_voice_sync(handle, dsp);
+		}
+	}
+
+	int64_t from = 0;
+	LV2_ATOM_SEQUENCE_FOREACH(handle->control, ev)
+	{
+		const int64_t to = _quantize(handle, ev->time.frames);
+		const LV2_Atom *atom = &ev->body;
+		const LV2_Atom_Object *obj = (const LV2_Atom_Object *)&ev->body;
+
+		// render up to the event, events on the same grid point share a slice
+		if(to > from)
+		{
+			timely_advance(&handle->timely, NULL, from, to);
+			_refresh_time_position(handle);
+			_play(handle, from, to);
+
+			from = to;
+		}
+
+		if( (atom->type == handle->midi_MidiEvent)
+			&& _mts_check(LV2_ATOM_BODY_CONST(atom), atom->size) )
+		{
+			// tuning messages are parsed on the worker, once for both dsps
+			_schedule_payload(handle, JOB_TYPE_MTS, LV2_ATOM_BODY_CONST(atom),
+				atom->size);
+		}
+		else if(atom->type == handle->midi_MidiEvent)
+		{
+			const bool off [2] = {
+				handle->play,
+				!handle->play
+			};
+
+			for(uint32_t d = 0; d < 2; d++)
+			{
+				dsp_t *dsp = handle->dsp[off[d]];
+
+				if(!dsp)
+				{
+					continue;
+				}
+
+				_handle_midi(handle, dsp, to, LV2_ATOM_BODY_CONST(atom),
+					atom->size);
+			}
+		}
+		else
+		{
+			props_advance(&handle->props, &handle->forge, to, obj,
+				&handle->ref);
+		}
+
+		timely_advance(&handle->timely, obj, to, to);
+	}
+
+	timely_advance(&handle->timely, NULL, from, nsamples);
+	_refresh_time_position(handle);
+
+	if(nsamples > from)
+	{
+		_play(handle, from, nsamples);
+	}
+
+	// report parked voices of the running dsp
+	{
+		dsp_t *dsp = handle->dsp[handle->play];
+		int32_t parked_voices = 0;
+
+		if(dsp)
+		{
+			VOICE_FOREACH(dsp, voice)
+			{
+				parked_voices += voice->parked;
+			}
+		}
+
+		if(parked_voices != handle->state.parked_voices)
+		{
+			handle->state.parked_voices = parked_voices;
+
+			props_set(&handle->props, &handle->forge, nsamples-1,
+				handle->mephisto_parkedVoices, &handle->ref);
+		}
+	}
+
+	// send error if applicable
+	if(handle->dirty.error)
+	{
+		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_error,
+			&handle->ref);
+
+		handle->dirty.error = false;
+	}
+
+	if(handle->dirty.queue)
+	{
+		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_compileQueue,
+			&handle->ref);
+
+		handle->dirty.queue = false;
+	}
+
+	if(handle->dirty.tune)
+	{
+		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_autoTune,
+			&handle->ref);
+		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_tunedOptions,
+			&handle->ref);
+
+		handle->dirty.tune = false;
+	}
+
+	if(handle->latency)
+	{
+		*handle->latency = handle->fifo_latency;
+	}
+
+	if(handle->pool)
+	{
+		_voice_pool_load(handle, nsamples);
+	}
+
+	if(handle->dirty.load)
+	{
+		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_voiceLoad,
+			&handle->ref);
+
+		handle->dirty.load = false;
+	}
+
+	if(handle->dirty.block_length)
+	{
+		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_blockLength,
+			&handle->ref);
+
+		handle->dirty.block_length = false;
+	}
+
+	if(handle->dirty.quantization)
+	{
+		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_quantization,
+			&handle->ref);
+
+		handle->dirty.quantization = false;
+	}
+
+	if(handle->dirty.silence_blocks)
+	{
+		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_silenceBlocks,
+			&handle->ref);
+
+		handle->dirty.silence_blocks = false;
+	}
+
+	if(handle->dirty.voice_threads)
+	{
+		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_voiceThreads,
+			&handle->ref);
+
+		handle->dirty.voice_threads = false;
+	}
+
+	if(handle->dirty.target)
+	{
+		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_target,
+			&handle->ref);
+
+		handle->dirty.target = false;
+	}
+
+	if(handle->dirty.stats)
+	{
+		for(unsigned i = 0; i < NSTATS; i++)
+		{
+			props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_stats[i],
+				&handle->ref);
+		}
+
+		handle->dirty.stats = false;
+	}
+
+	if(handle->dirty.attributes)
+	{
+		for(unsigned i = 0; i < NCONTROLS; i++)
+		{
+			props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_controlMin[i],
+				&handle->ref);
+			props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_controlMax[i],
+				&handle->ref);
+			props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_controlStep[i],
+				&handle->ref);
+			props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_controlType[i],
+				&handle->ref);
+			props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_controlLabel[i],
+				&handle->ref);
+		}
+
+		handle->dirty.attributes = false;
+	}
+
+	props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_timestamp,
+		&handle->ref);
+
+	for(unsigned i = 0; i < NCONTROLS; i++)
+	{
+		dsp_t *dsp = handle->dsp[handle->play];
+
+		if(!dsp)
+		{
+			continue;
+		}
+
+		voice_t *voice = &dsp->voices[0];
+		cntrl_t *cntrl = &voice->cntrls[i];
+
+		if(!cntrl->readonly)
+		{
+			continue;
+		}
+
+		handle->state.control[i] = _cntrl_get_value_rel(&voice->cntrls[i]);
+
+		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_control[i],
+			&handle->ref);
+	}
+
+	handle->state.timestamp += nsamples;
+
+	if(handle->ref)
+	{
+		lv2_atom_forge_pop(&handle->forge, &frame);
+	}
+	else
+	{
+		lv2_atom_sequence_clear(handle->notify);
+
+		if(handle->log)
+		{
+			lv2_log_trace(&handle->logger, "forge buffer overflow\n");
+		}
+	}
+}
+
+static void
+_meta_declare(void *iface, const char *key, const char *val)
+{
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
+
+	DBG(handle, "[%s] %s %s", __func__, key, val);
+
+	if(!strcmp(key, "options"))
+	{
+		// iterate over options values
+		for(const char *ptr = strchr(val, '['); ptr; ptr = strchr(++ptr, '['))
+		{
+			if(sscanf(ptr, "[nvoices:%"SCNu32"]", &dsp->nvoices) == 1)
+			{
+				if( (dsp->nvoices == 0) || (dsp->nvoices > MAX_VOICES) )
+				{
+					dsp->nvoices = MAX_VOICES;
+				}
+			}
+			else if(strcasestr(ptr, "[midi:on]") == ptr)
+			{
+				dsp->midi_on = true;
+			}
+			else if(strcasestr(ptr, "[time:on]") == ptr)
+			{
+				dsp->time_on = true;
+			}
+			else if(strcasestr(ptr, "[lazy:on]") == ptr)
+			{
+				dsp->nlazy = LAZY_WARM;
+			}
+			else if(sscanf(ptr, "[lazy:%"SCNu32"]", &dsp->nlazy) == 1)
+			{
+				if(dsp->nlazy == 0)
+				{
+					dsp->nlazy = 1;
+				}
+			}
+			else if(strcasestr(ptr, "[steal:oldest]") == ptr)
+			{
+				dsp->steal = STEAL_OLDEST;
+			}
+			else if(strcasestr(ptr, "[steal:quietest]") == ptr)
+			{
+				dsp->steal = STEAL_QUIETEST;
+			}
+			else if(strcasestr(ptr, "[steal:samekey]") == ptr)
+			{
+				dsp->steal = STEAL_SAMEKEY;
+			}
+			else if(strncasecmp(ptr, "[compile:", 9) == 0)
+			{
+				const char *end = strchr(ptr, ']');
+
+				_args_scan(dsp->compile_options, sizeof(dsp->compile_options), ptr,
+					end ? (size_t)(end - ptr + 1) : strlen(ptr));
+			}
+		}
+	}
+}
+
+static const char *
+_strendswith(const char *haystack, const char *needle)
+{
+	const char *match = strcasestr(haystack, needle);
+
+	if(match)
+	{
+		const size_t needle_len = strlen(needle);
+
+		if(match[needle_len] == '\0')
+		{
+			return match;
+		}
+	}
+
+	return NULL;
+}
 
-	handle->mephisto_controlLabel[0] = props_map(&handle->props, MEPHISTO__controlLabel_1);
-	handle->mephisto_controlLabel[1] = props_map(&handle->props, MEPHISTO__controlLabel_2);
-	handle->mephisto_controlLabel[2] = props_map(&handle->props, MEPHISTO__controlLabel_3);
-	handle->mephisto_controlLabel[3] = props_map(&handle->props, MEPHISTO__controlLabel_4);
-	handle->mephisto_controlLabel[4] = props_map(&handle->props, MEPHISTO__controlLabel_5);
-	handle->mephisto_controlLabel[5] = props_map(&handle->props, MEPHISTO__controlLabel_6);
-	handle->mephisto_controlLabel[6] = props_map(&handle->props, MEPHISTO__controlLabel_7);
-	handle->mephisto_controlLabel[7] = props_map(&handle->props, MEPHISTO__controlLabel_8);
-	handle->mephisto_controlLabel[8] = props_map(&handle->props, MEPHISTO__controlLabel_9);
-	handle->mephisto_controlLabel[9] = props_map(&handle->props, MEPHISTO__controlLabel_10);
-	handle->mephisto_controlLabel[10] = props_map(&handle->props, MEPHISTO__controlLabel_11);
-	handle->mephisto_controlLabel[11] = props_map(&handle->props, MEPHISTO__controlLabel_12);
-	handle->mephisto_controlLabel[12] = props_map(&handle->props, MEPHISTO__controlLabel_13);
-	handle->mephisto_controlLabel[13] = props_map(&handle->props, MEPHISTO__controlLabel_14);
-	handle->mephisto_controlLabel[14] = props_map(&handle->props, MEPHISTO__controlLabel_15);
-	handle->mephisto_controlLabel[15] = props_map(&handle->props, MEPHISTO__controlLabel_16);
+static voice_t *
+_current_voice(dsp_t *dsp)
+{
+	if(dsp->cvoices < dsp->nvoices)
+	{
+		return &dsp->voices[dsp->cvoices];
+	}
+
+	return NULL;
+}
+
+static cntrl_t *
+_ui_next_cntrl(dsp_t *dsp, cntrl_type_t type, const char *label)
+{
+	cntrl_t *cntrl = NULL;
+	voice_t *voice = _current_voice(dsp);
+
+	if(!voice)
+	{
+		return NULL;
+	}
+
+	if(dsp->is_instrument && _strendswith(label, "gain"))
+	{
+		cntrl = &voice->gain;
+	}
+	else if(dsp->is_instrument && _strendswith(label, "gate"))
+	{
+		cntrl = &voice->gate;
+	}
+	else if(dsp->is_instrument && _strendswith(label, "dfreq"))
+	{
+		cntrl = &voice->d_freq;
+	}
+	else if(dsp->is_instrument && _strendswith(label, "dpressure"))
+	{
+		cntrl = &voice->d_pressure;
+	}
+	else if(dsp->is_instrument && _strendswith(label, "dtimbre"))
+	{
+		cntrl = &voice->d_timbre;
+	}
+	else if(dsp->is_instrument && _strendswith(label, "freq"))
+	{
+		cntrl = &voice->freq;
+	}
+	else if(dsp->is_instrument && _strendswith(label, "pressure"))
+	{
+		cntrl = &voice->pressure;
+	}
+	else if(dsp->is_instrument && _strendswith(label, "timbre"))
+	{
+		cntrl = &voice->timbre;
+	}
+	else if(dsp->timely_mask)
+	{
+		switch(dsp->timely_mask)
+		{
+			case TIMELY_MASK_BAR_BEAT:
+			{
+				cntrl = &voice->pos.bar_beat;
+			} break;
+			case TIMELY_MASK_BAR:
+			{
+				cntrl = &voice->pos.bar;
+			} break;
+			case TIMELY_MASK_BEAT_UNIT:
+			{
+				cntrl = &voice->pos.beat_unit;
+			} break;
+			case TIMELY_MASK_BEATS_PER_BAR:
+			{
+				cntrl = &voice->pos.beats_per_bar;
+			} break;
+			case TIMELY_MASK_BEATS_PER_MINUTE:
+			{
+				cntrl = &voice->pos.beats_per_minute;
+			} break;
+			case TIMELY_MASK_FRAME:
+			{
+				cntrl = &voice->pos.frame;
+			} break;
+			case TIMELY_MASK_FRAMES_PER_SECOND:
+			{
+				cntrl = &voice->pos.frames_per_second;
+			} break;
+			case TIMELY_MASK_SPEED:
+			{
+				cntrl = &voice->pos.speed;
+			} break;
+			case TIMELY_MASK_BAR_BEAT_WHOLE:
+			{
+				// not used
+			} break;
+			case TIMELY_MASK_BAR_WHOLE:
+			{
+				// not used
+			} break;
+		}
+
+		dsp->timely_mask = 0; // reset flag
+	}
+	else if( (dsp->idx >= 0) && (dsp->idx < NCONTROLS) )
+	{
+		cntrl = &voice->cntrls[dsp->idx];
+
+		dsp->idx = -1;
+	}
+
+	if(!cntrl)
+	{
+		return NULL;
+	}
+
+	cntrl->type = type;
+	strncpy(cntrl->label, label, sizeof(cntrl->label) - 1);
+
+	return cntrl;
+}
+
+static void
+_ui_open_tab_box(void* iface, const char* label)
+{
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
+
+	DBG(handle, "[%s] %s", __func__, label);
+}
+
+static void
+_ui_open_horizontal_box(void* iface, const char* label)
+{
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
+
+	DBG(handle, "[%s] %s", __func__, label);
+}
+
+static void
+_ui_open_vertical_box(void* iface, const char* label)
+{
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
+
+	DBG(handle, "[%s] %s", __func__, label);
+}
+
+static void
+_ui_close_box(void* iface)
+{
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
+
+	DBG(handle, "[%s]", __func__);
+}
+
+static void
+_ui_add_button(void* iface, const char* label, FAUSTFLOAT* zone)
+{
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
+
+	DBG(handle, "[%s] %s %f", __func__, label, *zone);
+
+	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_BUTTON, label);
+	if(!cntrl)
+	{
+		return;
+	}
+
+	cntrl->zone = zone;
+}
+
+static void
+_ui_add_check_button(void* iface, const char* label, FAUSTFLOAT* zone)
+{
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
+
+	DBG(handle, "[%s] %s %f", __func__, label, *zone);
+
+	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_CHECK_BUTTON, label);
+	if(!cntrl)
+	{
+		return;
+	}
+
+	cntrl->zone = zone;
+}
+
+static void
+_ui_add_vertical_slider(void* iface, const char* label, FAUSTFLOAT* zone,
+	FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
+{
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
+
+	DBG(handle, "[%s] %s %f %f %f %f %f", __func__,
+		label, *zone, init, min, max, step);
+
+	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_VERTICAL_SLIDER, label);
+	if(!cntrl)
+	{
+		return;
+	}
+
+	cntrl->zone = zone;
+	cntrl->vertical_slider.init = init;
+	cntrl->vertical_slider.min = min;
+	cntrl->vertical_slider.max = max;
+	cntrl->vertical_slider.ran = max - min;
+	cntrl->vertical_slider.step = step;
+}
+
+static void
+_ui_add_horizontal_slider(void* iface, const char* label, FAUSTFLOAT* zone,
+	FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
+{
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
 
-	handle->to_worker = varchunk_new(BUF_SIZE, true);
-	handle->srate = rate;
+	DBG(handle, "[%s] %s %f %f %f %f %f", __func__,
+		label, *zone, init, min, max, step);
 
-	for(uint32_t chn = 0; chn < 0x10; chn++)
+	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_HORIZONTAL_SLIDER, label);
+	if(!cntrl)
 	{
-		handle->range[chn] = 48.f; // semitones
+		return;
 	}
 
-	const timely_mask_t mask = 0;
-	timely_init(&handle->timely, handle->map, rate, mask, _timely_cb, handle);
-	timely_set_multiplier(&handle->timely, 1.f);
-
-	return handle;
+	cntrl->zone = zone;
+	cntrl->horizontal_slider.init = init;
+	cntrl->horizontal_slider.min = min;
+	cntrl->horizontal_slider.max = max;
+	cntrl->horizontal_slider.ran = max - min;
+	cntrl->horizontal_slider.step = step;
 }
 
 static void
-connect_port(LV2_Handle instance, uint32_t port, void *data)
+_ui_add_num_entry(void* iface, const char* label, FAUSTFLOAT* zone,
+	FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
 {
-	plughandle_t *handle = (plughandle_t *)instance;
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
 
-	switch(port)
-	{
-		case 0:
-			handle->control = (const LV2_Atom_Sequence *)data;
-			break;
-		case 1:
-			handle->notify = (LV2_Atom_Sequence *)data;
-			break;
+	DBG(handle, "[%s] %s %f %f %f %f %f", __func__,
+		label, *zone, init, min, max, step);
 
-		case 2:
-			handle->audio_in[0] = (const float *)data;
-			break;
-		case 3:
-			handle->audio_out[0] = (float *)data;
-			break;
+	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_NUM_ENTRY, label);
+	if(!cntrl)
+	{
+		return;
+	}
 
-		case 4:
-			handle->audio_in[1] = (const float *)data;
-			break;
-		case 5:
-			handle->audio_out[1] = (float *)data;
-			break;
+	cntrl->zone = zone;
+	cntrl->num_entry.init = init;
+	cntrl->num_entry.min = min;
+	cntrl->num_entry.max = max;
+	cntrl->num_entry.ran = max - min;
+	cntrl->num_entry.step = step;
+}
 
-		case 6:
-			handle->audio_in[2] = (const float *)data;
-			break;
-		case 7:
-			handle->audio_out[2] = (float *)data;
-			break;
+static void
+_ui_add_horizontal_bargraph(void* iface, const char* label, FAUSTFLOAT* zone,
+	FAUSTFLOAT min, FAUSTFLOAT max)
+{
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
 
-		case 8:
-			handle->audio_in[3] = (const float *)data;
-			break;
-		case 9:
-			handle->audio_out[3] = (float *)data;
-			break;
+	DBG(handle, "[%s] %s %f %f %f", __func__,
+		label, *zone, min, max);
 
-		case 10:
-			handle->audio_in[4] = (const float *)data;
-			break;
-		case 11:
-			handle->audio_out[4] = (float *)data;
-			break;
+	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_HORIZONTAL_BARGRAPH, label);
+	if(!cntrl)
+	{
+		return;
+	}
 
-		case 12:
-			handle->audio_in[5] = (const float *)data;
-			break;
-		case 13:
-			handle->audio_out[5] = (float *)data;
-			break;
+	cntrl->zone = zone;
+	cntrl->readonly = true;
+	cntrl->horizontal_bargraph.min = min;
+	cntrl->horizontal_bargraph.max = max;
+	cntrl->horizontal_bargraph.ran_1 = 1.f / (max - min);
+}
 
-		case 14:
-			handle->audio_in[6] = (const float *)data;
-			break;
-		case 15:
-			handle->audio_out[6] = (float *)data;
-			break;
+static void
+_ui_add_vertical_bargraph(void* iface, const char* label, FAUSTFLOAT* zone,
+	FAUSTFLOAT min, FAUSTFLOAT max)
+{
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
 
-		case 16:
-			handle->audio_in[7] = (const float *)data;
-			break;
-		case 17:
-			handle->audio_out[7] = (float *)data;
-			break;
+	DBG(handle, "[%s] %s %f %f %f", __func__,
+		label, *zone, min, max);
 
-		default:
-			break;
+	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_VERTICAL_BARGRAPH, label);
+	if(!cntrl)
+	{
+		return;
 	}
+
+	cntrl->zone = zone;
+	cntrl->readonly = true;
+	cntrl->vertical_bargraph.min = min;
+	cntrl->vertical_bargraph.max = max;
+	cntrl->vertical_bargraph.ran_1 = 1.f / (max - min);
 }
 
-static inline float
-_midi2cps(float pitch)
+static void
+_ui_add_sound_file(void* iface, const char* label, const char* filename,
+	struct Soundfile** sf_zone __attribute__((unused)))
 {
-	return exp2f( (pitch - 69.f) / 12.f) * 440.f;
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
+
+	DBG(handle, "[%s] %s %s", __func__,
+		label, filename);
+
+	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_SOUND_FILE, label);
+	if(!cntrl)
+	{
+		return;
+	}
+
+	//FIXME
 }
 
-static inline voice_t *
-_next_available_voice(dsp_t *dsp)
+static void
+_ui_declare(void* iface, FAUSTFLOAT* zone __attribute__((unused)),
+	const char* key, const char* value)
 {
-	uint32_t i;
+	dsp_t *dsp = iface;
+	plughandle_t *handle = dsp->handle;
 
-	for(i = 0, dsp->ivoice = (dsp->ivoice + i + 1) % dsp->nvoices;
-		i < dsp->nvoices;
-		i++, dsp->ivoice = (dsp->ivoice + i) % dsp->nvoices)
+	DBG(handle, "[%s] %s %s", __func__,
+		key, value);
+
+	if(!strcasecmp(value, ""))
 	{
-		voice_t *voice = &dsp->voices[dsp->ivoice];
+		char *endptr = NULL;
+		const long int idx = strtol(key, &endptr, 10);
 
-		if(voice->state == VOICE_STATE_INACTIVE)
+		if(endptr != key)
 		{
-			return voice;
+			dsp->idx = idx;
 		}
-	}
-
-	for(i = 0, dsp->ivoice = (dsp->ivoice + i) % dsp->nvoices;
-		i < dsp->nvoices;
-		i++, dsp->ivoice = (dsp->ivoice + i) % dsp->nvoices)
-	{
-		voice_t *voice = &dsp->voices[dsp->ivoice];
-
-		if(voice->state & VOICE_STATE_SUSTAIN)
+		else if(handle->log)
 		{
-			return voice;
+			lv2_log_error(&handle->logger, "[%s] invalid index key %s",
+				__func__, key);
 		}
 	}
-
-	for(i = 0, dsp->ivoice = (dsp->ivoice + i) % dsp->nvoices;
-		i < dsp->nvoices;
-		i++, dsp->ivoice = (dsp->ivoice + i) % dsp->nvoices)
+	else if(!strcasecmp(key, "time"))
 	{
-		voice_t *voice = &dsp->voices[dsp->ivoice];
-
-		if(voice->state & VOICE_STATE_ACTIVE)
+		if(!strcasecmp(value, "barBeat"))
 		{
-			return voice;
+			dsp->timely_mask = TIMELY_MASK_BAR_BEAT;
 		}
-	}
-
-	return NULL;
-}
-
-static inline voice_t *
-_find_active_voice(dsp_t *dsp, const hash_t *hash)
-{
-	VOICE_FOREACH(dsp, voice)
-	{
-		if(  (voice->state == VOICE_STATE_ACTIVE)
-			&& (voice->hash.id == hash->id) )
+		else if(!strcasecmp(value, "bar"))
 		{
-			return voice;
+			dsp->timely_mask = TIMELY_MASK_BAR;
 		}
-	}
-
-	return NULL;
-}
-
-static inline void
-_update_frequency(plughandle_t *handle, dsp_t *dsp, uint8_t chn)
-{
-	VOICE_FOREACH(dsp, voice)
-	{
-		if(voice->state & VOICE_STATE_ACTIVE)
+		else if(!strcasecmp(value, "beatUnit"))
 		{
-			if(voice->hash.chn == chn)
-			{
-				const float freq = _midi2cps(voice->hash.key
-					+ handle->bend[chn]*handle->range[chn]);
-
-				_cntrl_refresh_value_abs(&voice->freq, freq);
-			}
+			dsp->timely_mask = TIMELY_MASK_BEAT_UNIT;
 		}
-	}
-}
-
-static inline void
-_update_pressure(plughandle_t *handle, dsp_t *dsp, uint8_t chn)
-{
-	VOICE_FOREACH(dsp, voice)
-	{
-		if(voice->state & VOICE_STATE_ACTIVE)
+		else if(!strcasecmp(value, "beatsPerBar"))
 		{
-			if(voice->hash.chn == chn)
-			{
-				const float pressure = handle->pressure[chn] * 0x1p-14;
-
-				_cntrl_refresh_value_abs(&voice->pressure, pressure);
-			}
+			dsp->timely_mask = TIMELY_MASK_BEATS_PER_BAR;
 		}
-	}
-}
-
-static inline void
-_update_timbre(plughandle_t *handle, dsp_t *dsp, uint8_t chn)
-{
-	VOICE_FOREACH(dsp, voice)
-	{
-		if(voice->state & VOICE_STATE_ACTIVE)
+		else if(!strcasecmp(value, "beatsPerMinute"))
+		{
+			dsp->timely_mask = TIMELY_MASK_BEATS_PER_MINUTE;
+		}
+		else if(!strcasecmp(value, "frame"))
+		{
+			dsp->timely_mask = TIMELY_MASK_FRAME;
+		}
+		else if(!strcasecmp(value, "framesPerSecond"))
+		{
+			dsp->timely_mask = TIMELY_MASK_FRAMES_PER_SECOND;
+		}
+		else if(!strcasecmp(value, "speed"))
+		{
+			dsp->timely_mask = TIMELY_MASK_SPEED;
+		}
+		else if(handle->log)
 		{
-			if(voice->hash.chn == chn)
-			{
-				const float timbre = handle->timbre[chn] * 0x1p-14;
-
-				_cntrl_refresh_value_abs(&voice->timbre, timbre);
-			}
+			lv2_log_error(&handle->logger, "[%s] invalid time value %s",
+				__func__, value);
 		}
 	}
-}
-
-static inline void
-_voice_off(plughandle_t *handle, voice_t *voice)
-{
-	if(handle->sustain[voice->hash.chn])
-	{
-		voice->state |= VOICE_STATE_SUSTAIN;
-	}
-	else
+	else if(handle->log)
 	{
-		_cntrl_refresh_value_abs(&voice->gate, 0.f);
-
-		voice->state = VOICE_STATE_INACTIVE;
+			lv2_log_note(&handle->logger, "[%s] unknown key:value pair %s:%s",
+				__func__, key, value);
 	}
 }
 
-static inline void
-_voice_off_panic(voice_t *voice)
+static int
+_meta_init(dsp_t *dsp, voice_t *base_voice)
 {
-	_cntrl_refresh_value_abs(&voice->gate, 0.f);
+	MetaGlue *glue = &dsp->meta_glue;
+
+	glue->metaInterface = dsp;
+
+	glue->declare = _meta_declare;
+
+	dsp->nvoices = 1; // assume we're a filter by default
+	dsp->timely_mask = 0;
+	dsp->idx = -1;
 
-	voice->state = VOICE_STATE_INACTIVE;
+	_voice_metadata(dsp, base_voice, glue);
+
+	return 0;
 }
 
-static inline void
-_voice_off_force(voice_t *voice)
+static int
+_ui_init(dsp_t *dsp)
 {
-	_cntrl_refresh_value_abs(&voice->gate, 0.f);
+	UIGlue *glue = &dsp->ui_glue;
+
+	glue->uiInterface = dsp;
+
+	glue->openTabBox = _ui_open_tab_box;
+	glue->openHorizontalBox = _ui_open_horizontal_box;
+	glue->openVerticalBox = _ui_open_vertical_box;
+	glue->closeBox = _ui_close_box;
+	glue->addButton = _ui_add_button;
+	glue->addCheckButton = _ui_add_check_button;
+	glue->addVerticalSlider = _ui_add_vertical_slider;
+	glue->addHorizontalSlider = _ui_add_horizontal_slider;
+	glue->addNumEntry = _ui_add_num_entry;
+	glue->addHorizontalBargraph = _ui_add_horizontal_bargraph;
+	glue->addVerticalBargraph = _ui_add_vertical_bargraph;
+	glue->FAUST_ADDSOUNDFILE= _ui_add_sound_file;
+	glue->declare = _ui_declare;
 
-	voice->state = VOICE_STATE_INACTIVE;
+	return 0;
 }
 
+// binds the controls of voices [first, last), not yet published to rt-thread
 static void
-_handle_midi_2(dsp_t *dsp,
-	int64_t frames __attribute__((unused)), const uint8_t *msg)
+_ui_build(dsp_t *dsp, uint32_t first, uint32_t last)
 {
-	const uint8_t cmd = msg[0] & 0xf0;
-
-	if(!dsp || !dsp->is_instrument || !dsp->midi_on)
+	for(dsp->cvoices = first; dsp->cvoices < last; dsp->cvoices++)
 	{
-		return;
+		voice_t *voice = &dsp->voices[dsp->cvoices];
+
+		if(voice->instance)
+		{
+			_voice_build_ui(dsp, voice, &dsp->ui_glue);
+		}
 	}
+}
 
-	switch(cmd)
+static void *
+_voice_spawn_thread(void *data)
+{
+	spawn_t *spawn = data;
+	dsp_t *dsp = spawn->dsp;
+
+	for(uint32_t v = spawn->first; v < spawn->last; v++, spawn->done++)
 	{
-		case LV2_MIDI_MSG_CONTROLLER:
+		voice_t *voice = &dsp->voices[v];
+
+		if(_voice_clone(dsp, voice, spawn->base_voice) != 0)
 		{
-			const uint8_t ctr = msg[1];
+			break;
+		}
 
-			switch(ctr)
-			{
-				case LV2_MIDI_CTL_ALL_NOTES_OFF:
-				{
-					VOICE_FOREACH(dsp, voice)
-					{
-						_voice_off_panic(voice);
-					}
-				} break;
-				case LV2_MIDI_CTL_ALL_SOUNDS_OFF:
-				{
-					VOICE_FOREACH(dsp, voice)
-					{
-						_voice_off_force(voice);
-					}
-				} break;
-			}
-		} break;
+		_voice_init(dsp, voice, spawn->srate);
 	}
+
+	return NULL;
 }
 
-static void
-_handle_midi_3(plughandle_t *handle, dsp_t *dsp,
-	int64_t frames __attribute__((unused)), const uint8_t *msg)
+// clones and initializes voices [first, last) from the base voice on one
+// thread per CPU, SPAWN_THREADS_MAX at most, returns the end of the contiguous
+// range of voices created
+static uint32_t
+_voice_spawn(plughandle_t *handle, dsp_t *dsp, uint32_t first, uint32_t last)
 {
-	const uint8_t cmd = msg[0] & 0xf0;
-	const uint8_t chn = msg[0] & 0x0f;
-
-	if(!dsp || !dsp->is_instrument || !dsp->midi_on)
+	spawn_t spawns [SPAWN_THREADS_MAX];
+	bool threaded [SPAWN_THREADS_MAX];
+	const uint32_t count = last - first;
+	uint32_t nthreads = (ncpus < SPAWN_THREADS_MAX)
+		? ncpus
+		: SPAWN_THREADS_MAX;
+
+	if(count == 0)
 	{
-		return;
+		return first;
 	}
 
-	switch(cmd)
+	if(nthreads > count)
 	{
-		case LV2_MIDI_MSG_NOTE_ON:
-		{
-			const uint8_t key = msg[1];
-			const uint8_t vel = msg[2];
+		nthreads = count;
+	}
 
-			voice_t *voice = _next_available_voice(dsp);
-			if(voice)
-			{
-				const float freq = _midi2cps((float)key
-					+ handle->bend[chn]*handle->range[chn]);
+	const uint32_t chunk = (count + nthreads - 1) / nthreads;
+	nthreads = (count + chunk - 1) / chunk;
 
-				_cntrl_refresh_value_abs(&voice->freq, freq);
-				_cntrl_refresh_value_abs(&voice->gain, vel * 0x1p-7);
-				_cntrl_refresh_value_abs(&voice->gate, 0.f);
+	for(uint32_t t = 0; t < nthreads; t++)
+	{
+		spawn_t *spawn = &spawns[t];
+
+		spawn->dsp = dsp;
+		spawn->base_voice = _voice_begin(dsp);
+		spawn->srate = handle->srate;
+		spawn->first = first + t*chunk;
+		spawn->last = (spawn->first + chunk < last)
+			? spawn->first + chunk
+			: last;
+		spawn->done = 0;
+
+		// the first chunk is run on the calling thread
+		threaded[t] = (t > 0)
+			&& (pthread_create(&spawn->thread, NULL, _voice_spawn_thread, spawn) == 0);
+	}
 
-				voice->hash.key = key;
-				voice->hash.chn = chn;
-				voice->state = VOICE_STATE_ACTIVE;
-				voice->retrigger = true;
-			}
-		} break;
-		case LV2_MIDI_MSG_NOTE_OFF:
+	for(uint32_t t = 0; t < nthreads; t++)
+	{
+		if(!threaded[t])
 		{
-			const uint8_t key = msg[1];
+			_voice_spawn_thread(&spawns[t]);
+		}
+	}
 
-			const hash_t hash = {
-				.key= key,
-				.chn = chn
-			};
+	uint32_t end = first;
 
-			voice_t *voice = _find_active_voice(dsp, &hash);
+	for(uint32_t t = 0; t < nthreads; t++)
+	{
+		spawn_t *spawn = &spawns[t];
 
-			if(voice)
-			{
-				_voice_off(handle, voice);
-			}
-		} break;
-		case LV2_MIDI_MSG_NOTE_PRESSURE:
+		if(threaded[t])
 		{
-			const uint8_t key = msg[1];
-			const uint8_t pre = msg[2];
+			pthread_join(spawn->thread, NULL);
+		}
 
-			const hash_t hash = {
-				.key= key,
-				.chn = chn
-			};
+		if(end == spawn->first)
+		{
+			end += spawn->done;
+		}
+	}
 
-			voice_t *voice = _find_active_voice(dsp, &hash);
+	if(end < last)
+	{
+		// only ever publish a contiguous range of voices
+		for(uint32_t v = end; v < last; v++)
+		{
+			voice_t *voice = &dsp->voices[v];
 
-			if(voice)
+			if(voice->instance)
 			{
-				_cntrl_refresh_value_abs(&voice->pressure, pre * 0x1p-7);
+				_voice_delete(dsp, voice);
 			}
-		} break;
-		case LV2_MIDI_MSG_BENDER:
-		{
-			const uint8_t lsb = msg[1];
-			const uint8_t msb = msg[2];
-			const int16_t bend = (msb << 7) | lsb;
+		}
 
-			handle->bend[chn] = (bend - 0x2000) * 0x1p-13;
-			_update_frequency(handle, dsp, chn);
-		} break;
-		case LV2_MIDI_MSG_CONTROLLER:
+		if(handle->log)
 		{
-			const uint8_t ctr = msg[1];
-			const uint8_t val = msg[2];
+			lv2_log_error(&handle->logger, "[%s] instance creation failed", __func__);
+		}
+	}
 
-			switch(ctr)
+	return end;
+}
+
+static int
+_dsp_factory_create(plughandle_t *handle, dsp_t *dsp, const char *code,
+	int argc, const char *argv [], const char *machine, char *err,
+	LV2_Worker_Respond_Function respond, LV2_Worker_Respond_Handle target)
+{
+#if defined(_FAUST_HAS_INTERPRETER)
+	if(dsp->tier == TIER_INTERPRETER)
+	{
+		const char *argv_int [ARGV_MAX];
+		int argc_int = 0;
+
+		// the interpreter has no work-stealing scheduler
+		for(int i = 0; i < argc; i++)
+		{
+			if(strcmp(argv[i], PARALLEL_OPTION))
 			{
-				case LV2_MIDI_CTL_SUSTAIN:
-				{
-					handle->sustain[chn] = (val > 0x3f)
-						? true
-						: false;
+				argv_int[argc_int++] = argv[i];
+			}
+		}
 
-					if(handle->sustain[chn] == false)
-					{
-						VOICE_FOREACH(dsp, voice)
-						{
-							if(  (voice->hash.chn == chn)
-								&& (voice->state & VOICE_STATE_SUSTAIN) )
-							{
-								_voice_off(handle, voice);
-							}
-						}
-					}
-				} break;
-				case LV2_MIDI_CTL_RPN_LSB:
-				{
-					handle->rpn_lsb[chn] = val;
-				} break;
-				case LV2_MIDI_CTL_RPN_MSB:
-				{
-					handle->rpn_msb[chn] = val;
-				} break;
-				case LV2_MIDI_CTL_LSB_DATA_ENTRY:
-				{
-					handle->data_lsb[chn] = val;
-				} break;
-				case LV2_MIDI_CTL_MSB_DATA_ENTRY:
-				{
-					// pitch-bend range
-					if( (handle->rpn_msb[chn] == 0x0) && (handle->rpn_lsb[chn] == 0x0) )
-					{
-						const uint8_t semi = val;
-						const uint8_t cent = handle->data_lsb[chn];
+		dsp->interpreter_factory = createCInterpreterDSPFactoryFromString(
+			"mephisto", code, argc_int, argv_int, err);
+		snprintf(dsp->machine, sizeof(dsp->machine), "interpreter");
 
-						handle->range[chn] = (float)semi + cent*0.01f;
-						_update_frequency(handle, dsp, chn);
-					}
-				} break;
+		return dsp->interpreter_factory ? 0 : -1;
+	}
+#endif
 
-				case LV2_MIDI_CTL_SC1_SOUND_VARIATION | 0x20:
-				{
-					handle->pressure[chn] &= 0x7f;
-					handle->pressure[chn] |= val;
-				} break;
-				case LV2_MIDI_CTL_SC1_SOUND_VARIATION:
-				{
-					handle->pressure[chn] &= 0x3f80;
-					handle->pressure[chn] |= val << 7;
+	// machine has been checked against the host target reported by LLVM
+	// beforehand, see _args_build, a failure is down to the code itself
+	dsp->factory = _factory_attach(handle, code, argc, argv, machine, err,
+		respond, target);
 
-					_update_pressure(handle, dsp, chn);
-				} break;
-				case LV2_MIDI_CTL_SC5_BRIGHTNESS | 0x20:
-				{
-					handle->timbre[chn] &= 0x7f;
-					handle->timbre[chn] |= val;
-				} break;
-				case LV2_MIDI_CTL_SC5_BRIGHTNESS:
-				{
-					handle->timbre[chn] &= 0x3f80;
-					handle->timbre[chn] |= val << 7;
+	snprintf(dsp->machine, sizeof(dsp->machine), "%s",
+		machine[0] ? machine : "generic");
 
-					_update_timbre(handle, dsp, chn);
-				} break;
-			}
-		} break;
-	}
+	return dsp->factory ? 0 : -1;
 }
 
 static void
-_handle_midi(plughandle_t *handle, dsp_t *dsp,
-	int64_t frames, const uint8_t *msg, uint32_t len)
+_dsp_factory_destroy(dsp_t *dsp)
 {
-	switch(len)
+#if defined(_FAUST_HAS_INTERPRETER)
+	if(dsp->interpreter_factory)
 	{
-		case 2:
-		{
-			_handle_midi_2(dsp, frames, msg);
-		} break;
-		case 3:
-		{
-			_handle_midi_3(handle, dsp, frames, msg);
-		} break;
+		deleteCInterpreterDSPFactory(dsp->interpreter_factory);
+	}
+#endif
+
+	if(dsp->factory)
+	{
+		_factory_detach(dsp->factory);
 	}
 }
 
-static void
-run(LV2_Handle instance, uint32_t nsamples)
+static int
+_dsp_init(plughandle_t *handle, dsp_t *dsp, tier_t tier, const char *code,
+	args_t *args,
+	LV2_Worker_Respond_Function respond, LV2_Worker_Respond_Handle target)
 {
-	plughandle_t *handle = instance;
+	char err [COMPILE_ERROR_SIZE];
+	stats_t *stats = &dsp->stats;
+	uint64_t t0;
 
-	const uint32_t capacity = handle->notify->atom.size;
-	LV2_Atom_Forge_Frame frame;
-	lv2_atom_forge_set_buffer(&handle->forge, (uint8_t *)handle->notify, capacity);
-	handle->ref = lv2_atom_forge_sequence_head(&handle->forge, &frame, 0);
+	{
+		const job_t job = {
+			.type = JOB_TYPE_ERROR_CLEAR,
+			.error = NULL
+		};
 
-	props_idle(&handle->props, &handle->forge, 0, &handle->ref);
+		respond(target, sizeof(job), &job);
+	}
 
-	int64_t from = 0;
-	LV2_ATOM_SEQUENCE_FOREACH(handle->control, ev)
-	{
-		const int64_t to = ev->time.frames;
-		const LV2_Atom *atom = &ev->body;
-		const LV2_Atom_Object *obj = (const LV2_Atom_Object *)&ev->body;
+	t0 = _clock_ns();
+	dsp->handle = handle;
+	dsp->tier = tier;
+	memset(err, 0x0, sizeof(err));
 
-		if(atom->type == handle->midi_MidiEvent)
+	if(_dsp_factory_create(handle, dsp, code, args->argc, args->argv,
+		args->machine, err, respond, target) != 0)
+	{
+		if(_superseded(handle))
 		{
-			const bool off [2] = {
-				handle->play,
-				!handle->play
-			};
+			goto superseded;
+		}
 
-			for(uint32_t d = 0; d < 2; d++)
-			{
-				dsp_t *dsp = handle->dsp[off[d]];
+		if(handle->log)
+		{
+			lv2_log_error(&handle->logger, "[%s] %s", __func__, err);
 
-				if(!dsp)
-				{
-					continue;
-				}
+			const job_t job = {
+				.type = JOB_TYPE_ERROR_APPEND,
+				.error = strdup(err)
+			};
 
-				_handle_midi(handle, dsp, to, LV2_ATOM_BODY_CONST(atom),
-					atom->size);
-			}
-		}
-		else
-		{
-			props_advance(&handle->props, &handle->forge, to, obj,
-				&handle->ref);
+			respond(target, sizeof(job), &job);
 		}
 
-		timely_advance(&handle->timely, obj, from, to);
-		_refresh_time_position(handle);
-		_play(handle, from, to);
-
-		from = to;
+		goto fail;
 	}
 
-	timely_advance(&handle->timely, NULL, from, nsamples);
-	_refresh_time_position(handle);
-	_play(handle, from, nsamples);
+	stats->factory = _clock_ns() - t0;
+	stats->memory_factory = dsp->factory ? dsp->factory->size : 0;
 
-	// send error if applicable
-	if(handle->dirty.error)
+	if(_superseded(handle))
 	{
-		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_error,
-			&handle->ref);
-
-		handle->dirty.error = false;
+		goto superseded;
 	}
 
-	if(handle->dirty.attributes)
+	t0 = _clock_ns();
+
+	voice_t *base_voice = _voice_begin(dsp);
+	if(_voice_create(dsp, base_voice) != 0)
 	{
-		for(unsigned i = 0; i < NCONTROLS; i++)
+		if(handle->log)
 		{
-			props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_controlMin[i],
-				&handle->ref);
-			props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_controlMax[i],
-				&handle->ref);
-			props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_controlStep[i],
-				&handle->ref);
-			props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_controlType[i],
-				&handle->ref);
-			props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_controlLabel[i],
-				&handle->ref);
+			lv2_log_error(&handle->logger, "[%s] instance creation failed", __func__);
 		}
 
-		handle->dirty.attributes = false;
+		goto fail;
 	}
 
-	props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_timestamp,
-		&handle->ref);
+	atomic_store_explicit(&dsp->nready, 1, memory_order_relaxed);
 
-	for(unsigned i = 0; i < NCONTROLS; i++)
+	stats->instance = _clock_ns() - t0;
+	t0 = _clock_ns();
+
+	_voice_init(dsp, base_voice, handle->srate);
+
+	stats->init = _clock_ns() - t0;
+
+	_voice_num_channels(dsp, base_voice, &dsp->nins, &dsp->nouts);
+
+	if( (dsp->nins > MAX_IO) || (dsp->nouts > MAX_IO) )
 	{
-		dsp_t *dsp = handle->dsp[handle->play];
+		snprintf(err, sizeof(err), "too many ins/outs (%"PRIu32"/%"PRIu32", max: %d)",
+			dsp->nins, dsp->nouts, MAX_IO);
 
-		if(!dsp)
+		if(handle->log)
 		{
-			continue;
+			lv2_log_error(&handle->logger, "[%s] %s", __func__, err);
+
+			const job_t job = {
+				.type = JOB_TYPE_ERROR_APPEND,
+				.error = strdup(err)
+			};
+
+			respond(target, sizeof(job), &job);
 		}
 
-		voice_t *voice = &dsp->voices[0];
-		cntrl_t *cntrl = &voice->cntrls[i];
+		goto fail;
+	}
 
-		if(!cntrl->readonly)
+	if(_meta_init(dsp, base_voice) != 0)
+	{
+		if(handle->log)
 		{
-			continue;
+			lv2_log_error(&handle->logger, "[%s] meta creation failed", __func__);
 		}
 
-		handle->state.control[i] = _cntrl_get_value_rel(&voice->cntrls[i]);
+		goto fail;
+	}
 
-		props_set(&handle->props, &handle->forge, nsamples-1, handle->mephisto_control[i],
-			&handle->ref);
+	// the metadata includes imported files, whose options are not scanned
+	if(strcmp(dsp->compile_options, args->compile_options) && handle->log)
+	{
+		lv2_log_warning(&handle->logger,
+			"[%s] [compile:%s] not declared in the code itself, ignored", __func__,
+			dsp->compile_options);
 	}
 
-	handle->state.timestamp += nsamples;
+	dsp->is_instrument = (dsp->nvoices > 1);
 
-	if(handle->ref)
+	// lazy mode hands over a warm pool only, the remaining voices are grown
+	// afterwards by _dsp_grow, restored state is always compiled in full
+	const uint32_t nwarm = (dsp->nlazy && (dsp->nlazy < dsp->nvoices) && !restoring)
+		? dsp->nlazy
+		: dsp->nvoices;
+
+	if(_superseded(handle))
 	{
-		lv2_atom_forge_pop(&handle->forge, &frame);
+		goto superseded;
 	}
-	else
+
+	t0 = _clock_ns();
+
+	const uint32_t nvoices = _voice_spawn(handle, dsp, 1, nwarm);
+
+	if(!dsp->is_instrument)
 	{
-		lv2_atom_sequence_clear(handle->notify);
+		base_voice->state = VOICE_STATE_ACTIVE;
+	}
 
+	stats->clone = _clock_ns() - t0;
+	// clones are of the same size as the base voice, those grown lazily included
+	stats->memory_instances = dsp->memory_voice * dsp->nvoices;
+	t0 = _clock_ns();
+
+	if(_ui_init(dsp) != 0)
+	{
 		if(handle->log)
 		{
-			lv2_log_trace(&handle->logger, "forge buffer overflow\n");
+			lv2_log_error(&handle->logger, "[%s] ui creation failed", __func__);
 		}
+
+		goto fail;
+	}
+
+	_ui_build(dsp, 0, nvoices);
+	atomic_store_explicit(&dsp->nready, nvoices, memory_order_release);
+	dsp->nsynced = nvoices;
+
+	stats->ui = _clock_ns() - t0;
+
+	if(_superseded(handle))
+	{
+		goto superseded;
+	}
+
+	if(handle->log)
+	{
+		lv2_log_note(&handle->logger,
+			"[%s] compilation succeeded (ins: %u, outs: %u, type: %s, backend: %s)",
+			__func__, dsp->nins, dsp->nouts,
+			dsp->is_instrument ? "instrument" : "filter",
+			(dsp->tier == TIER_INTERPRETER) ? "interpreter" : "llvm");
+
+		lv2_log_note(&handle->logger,
+			"[%s] timings (factory: %.1f ms, instance: %.1f ms, init: %.1f ms, "
+			"clone: %.1f ms for %"PRIu32" voices, ui: %.1f ms), "
+			"memory (machine code: %"PRIi64" B, instances: %"PRIi64" B)",
+			__func__, stats->factory * 1e-6, stats->instance * 1e-6,
+			stats->init * 1e-6, stats->clone * 1e-6, dsp->cvoices,
+			stats->ui * 1e-6, stats->memory_factory, stats->memory_instances);
+	}
+
+	return 0;
+
+superseded:
+	if(handle->log)
+	{
+		lv2_log_note(&handle->logger, "[%s] superseded by newer code", __func__);
 	}
+
+fail:
+	return 1;
 }
 
 static void
-_meta_declare(void *iface, const char *key, const char *val)
+_dsp_deinit(plughandle_t *handle __attribute__((unused)), dsp_t *dsp)
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
-
-	DBG(handle, "[%s] %s %s", __func__, key, val);
-
-	if(!strcmp(key, "options"))
+	if(dsp)
 	{
-		// iterate over options values
-		for(const char *ptr = strchr(val, '['); ptr; ptr = strchr(++ptr, '['))
+		const uint32_t nready = _voice_ready(dsp);
+
+		for(uint32_t i = 0; i < nready; i++)
 		{
-			if(sscanf(ptr, "[nvoices:%"SCNu32"]", &dsp->nvoices) == 1)
-			{
-				if( (dsp->nvoices == 0) || (dsp->nvoices > MAX_VOICES) )
-				{
-					dsp->nvoices = MAX_VOICES;
-				}
-			}
-			else if(strcasestr(ptr, "[midi:on]") == ptr)
-			{
-				dsp->midi_on = true;
-			}
-			else if(strcasestr(ptr, "[time:on]") == ptr)
+			voice_t *voice = &dsp->voices[i];
+
+			if(voice->instance)
 			{
-				dsp->time_on = true;
+				_voice_delete(dsp, voice);
 			}
 		}
+
+		_dsp_factory_destroy(dsp);
+
+		free(dsp);
 	}
 }
 
-static const char *
-_strendswith(const char *haystack, const char *needle)
+// non-rt thread, returns the dsp handed over to rt-thread
+static dsp_t *
+_dsp_compile(plughandle_t *handle, tier_t tier, const char *code,
+	args_t *args,
+	LV2_Worker_Respond_Function respond, LV2_Worker_Respond_Handle target)
 {
-	const char *match = strcasestr(haystack, needle);
+	dsp_t *dsp = calloc(1, sizeof(dsp_t));
 
-	if(match)
+	if(dsp && (_dsp_init(handle, dsp, tier, code, args, respond, target) == 0)
+		&& !_superseded(handle) )
 	{
-		const size_t needle_len = strlen(needle);
+		const job_t job = {
+			.type = JOB_TYPE_INIT,
+			.dsp = dsp
+		};
 
-		if(match[needle_len] == '\0')
-		{
-			return match;
-		}
+		respond(target, sizeof(job), &job);
+
+		return dsp;
 	}
 
+	_dsp_deinit(handle, dsp);
+
 	return NULL;
 }
 
-static voice_t *
-_current_voice(dsp_t *dsp)
+// worker thread, grows the voice pool of a lazily handed over dsp while
+// rt-thread already plays it, it is only ever deinitialized by a later job
+static void
+_dsp_grow(plughandle_t *handle, dsp_t *dsp)
 {
-	if(dsp->cvoices < dsp->nvoices)
+	const uint64_t t0 = _clock_ns();
+	const uint32_t nwarm = _voice_ready(dsp);
+	const uint32_t batch = (ncpus < SPAWN_THREADS_MAX)
+		? ncpus
+		: SPAWN_THREADS_MAX;
+	uint32_t nready = nwarm;
+
+	while( (nready < dsp->nvoices) && !_superseded(handle) )
 	{
-		return &dsp->voices[dsp->cvoices];
+		const uint32_t last = (nready + batch < dsp->nvoices)
+			? nready + batch
+			: dsp->nvoices;
+		const uint32_t end = _voice_spawn(handle, dsp, nready, last);
+
+		_ui_build(dsp, nready, end);
+		atomic_store_explicit(&dsp->nready, end, memory_order_release);
+		nready = end;
+
+		if(end < last)
+		{
+			break;
+		}
 	}
 
-	return NULL;
+	if( (nready > nwarm) && handle->log)
+	{
+		lv2_log_note(&handle->logger,
+			"[%s] voice pool grown from %"PRIu32" to %"PRIu32" voices in %.1f ms",
+			__func__, nwarm, nready, (_clock_ns() - t0) * 1e-6);
+	}
 }
 
-static cntrl_t *
-_ui_next_cntrl(dsp_t *dsp, cntrl_type_t type, const char *label)
+// worker thread, takes over the payload compiled on the state restore thread
+static void
+_payload_adopt(plughandle_t *handle)
 {
-	cntrl_t *cntrl = NULL;
-	voice_t *voice = _current_voice(dsp);
+	char *payload = atomic_exchange_explicit(&handle->restored_payload, NULL,
+		memory_order_acquire);
 
-	if(!voice)
+	if(payload)
 	{
-		return NULL;
+		free(handle->payload);
+		handle->payload = payload;
 	}
+}
 
-	if(dsp->is_instrument && _strendswith(label, "gain"))
-	{
-		cntrl = &voice->gain;
-	}
-	else if(dsp->is_instrument && _strendswith(label, "gate"))
-	{
-		cntrl = &voice->gate;
-	}
-	else if(dsp->is_instrument && _strendswith(label, "dfreq"))
-	{
-		cntrl = &voice->d_freq;
-	}
-	else if(dsp->is_instrument && _strendswith(label, "dpressure"))
-	{
-		cntrl = &voice->d_pressure;
-	}
-	else if(dsp->is_instrument && _strendswith(label, "dtimbre"))
+static const char *tune_variants [] = {
+	"-scal",
+	"-vec -lv 0 -vs 32",
+	"-vec -lv 0 -vs 128",
+	"-vec -lv 1 -vs 16",
+	"-vec -lv 1 -vs 32",
+	"-vec -lv 1 -vs 64",
+	"-vec -lv 1 -vs 128",
+	"-vec -lv 1 -vs 256",
+	"-vec -lv 1 -vs 512",
+	NULL
+};
+
+typedef struct _bench_t bench_t;
+
+struct _bench_t {
+	bool is_instrument;
+};
+
+static void
+_bench_declare(void *iface, const char *key, const char *val)
+{
+	bench_t *bench = iface;
+	uint32_t nvoices;
+
+	if(!strcmp(key, "options"))
 	{
-		cntrl = &voice->d_timbre;
+		for(const char *ptr = strchr(val, '['); ptr; ptr = strchr(++ptr, '['))
+		{
+			if(sscanf(ptr, "[nvoices:%"SCNu32"]", &nvoices) == 1)
+			{
+				bench->is_instrument = (nvoices != 1);
+			}
+		}
 	}
-	else if(dsp->is_instrument && _strendswith(label, "freq"))
+}
+
+// plays a held note on instruments, everything else stays at its default
+static void
+_bench_zone(bench_t *bench, const char *label, FAUSTFLOAT *zone,
+	FAUSTFLOAT min, FAUSTFLOAT max)
+{
+	FAUSTFLOAT val;
+
+	if(!bench->is_instrument)
 	{
-		cntrl = &voice->freq;
+		return;
 	}
-	else if(dsp->is_instrument && _strendswith(label, "pressure"))
+
+	if(_strendswith(label, "gate"))
 	{
-		cntrl = &voice->pressure;
+		val = 1.f;
 	}
-	else if(dsp->is_instrument && _strendswith(label, "timbre"))
+	else if(_strendswith(label, "dfreq") || _strendswith(label, "dpressure")
+		|| _strendswith(label, "dtimbre") )
 	{
-		cntrl = &voice->timbre;
+		return;
 	}
-	else if(dsp->timely_mask)
+	else if(_strendswith(label, "freq"))
 	{
-		switch(dsp->timely_mask)
-		{
-			case TIMELY_MASK_BAR_BEAT:
-			{
-				cntrl = &voice->pos.bar_beat;
-			} break;
-			case TIMELY_MASK_BAR:
-			{
-				cntrl = &voice->pos.bar;
-			} break;
-			case TIMELY_MASK_BEAT_UNIT:
-			{
-				cntrl = &voice->pos.beat_unit;
-			} break;
-			case TIMELY_MASK_BEATS_PER_BAR:
-			{
-				cntrl = &voice->pos.beats_per_bar;
-			} break;
-			case TIMELY_MASK_BEATS_PER_MINUTE:
-			{
-				cntrl = &voice->pos.beats_per_minute;
-			} break;
-			case TIMELY_MASK_FRAME:
-			{
-				cntrl = &voice->pos.frame;
-			} break;
-			case TIMELY_MASK_FRAMES_PER_SECOND:
-			{
-				cntrl = &voice->pos.frames_per_second;
-			} break;
-			case TIMELY_MASK_SPEED:
-			{
-				cntrl = &voice->pos.speed;
-			} break;
-			case TIMELY_MASK_BAR_BEAT_WHOLE:
-			{
-				// not used
-			} break;
-			case TIMELY_MASK_BAR_WHOLE:
-			{
-				// not used
-			} break;
-		}
-
-		dsp->timely_mask = 0; // reset flag
+		val = 440.f;
 	}
-	else if( (dsp->idx >= 0) && (dsp->idx < NCONTROLS) )
+	else if(_strendswith(label, "gain"))
 	{
-		cntrl = &voice->cntrls[dsp->idx];
-
-		dsp->idx = -1;
+		val = 0.5f;
 	}
-
-	if(!cntrl)
+	else
 	{
-		return NULL;
+		return;
 	}
 
-	cntrl->type = type;
-	strncpy(cntrl->label, label, sizeof(cntrl->label) - 1);
+	*zone = (val < min) ? min : ( (val > max) ? max : val);
+}
 
-	return cntrl;
+static void
+_bench_box(void *iface __attribute__((unused)),
+	const char *label __attribute__((unused)))
+{
 }
 
 static void
-_ui_open_tab_box(void* iface, const char* label)
+_bench_close_box(void *iface __attribute__((unused)))
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
+}
 
-	DBG(handle, "[%s] %s", __func__, label);
+static void
+_bench_button(void *iface, const char *label, FAUSTFLOAT *zone)
+{
+	_bench_zone(iface, label, zone, 0.f, 1.f);
 }
 
 static void
-_ui_open_horizontal_box(void* iface, const char* label)
+_bench_slider(void *iface, const char *label, FAUSTFLOAT *zone,
+	FAUSTFLOAT init __attribute__((unused)), FAUSTFLOAT min, FAUSTFLOAT max,
+	FAUSTFLOAT step __attribute__((unused)))
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
+	_bench_zone(iface, label, zone, min, max);
+}
 
-	DBG(handle, "[%s] %s", __func__, label);
+static void
+_bench_bargraph(void *iface __attribute__((unused)),
+	const char *label __attribute__((unused)),
+	FAUSTFLOAT *zone __attribute__((unused)),
+	FAUSTFLOAT min __attribute__((unused)), FAUSTFLOAT max __attribute__((unused)))
+{
 }
 
 static void
-_ui_open_vertical_box(void* iface, const char* label)
+_bench_sound_file(void *iface __attribute__((unused)),
+	const char *label __attribute__((unused)),
+	const char *filename __attribute__((unused)),
+	struct Soundfile **sf_zone __attribute__((unused)))
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
+}
 
-	DBG(handle, "[%s] %s", __func__, label);
+static void
+_bench_ui_declare(void *iface __attribute__((unused)),
+	FAUSTFLOAT *zone __attribute__((unused)),
+	const char *key __attribute__((unused)),
+	const char *value __attribute__((unused)))
+{
 }
 
+// non-rt thread, instruments are benchmarked with a held note, as a closed
+// gate lets many of them skip most of their work
 static void
-_ui_close_box(void* iface)
+_tune_bench_ui(llvm_dsp *instance)
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
+	bench_t bench = {
+		.is_instrument = false
+	};
+	MetaGlue meta_glue = {
+		.metaInterface = &bench,
+		.declare = _bench_declare
+	};
+	UIGlue ui_glue = {
+		.uiInterface = &bench,
+		.openTabBox = _bench_box,
+		.openHorizontalBox = _bench_box,
+		.openVerticalBox = _bench_box,
+		.closeBox = _bench_close_box,
+		.addButton = _bench_button,
+		.addCheckButton = _bench_button,
+		.addVerticalSlider = _bench_slider,
+		.addHorizontalSlider = _bench_slider,
+		.addNumEntry = _bench_slider,
+		.addHorizontalBargraph = _bench_bargraph,
+		.addVerticalBargraph = _bench_bargraph,
+		.FAUST_ADDSOUNDFILE = _bench_sound_file,
+		.declare = _bench_ui_declare
+	};
 
-	DBG(handle, "[%s]", __func__);
+	metadataCDSPInstance(instance, &meta_glue);
+	buildUserInterfaceCDSPInstance(instance, &ui_glue);
 }
 
-static void
-_ui_add_button(void* iface, const char* label, FAUSTFLOAT* zone)
+// non-rt thread, returns best time per block in ns or 0 on failure
+static uint64_t
+_tune_bench(plughandle_t *handle, llvm_dsp_factory *factory)
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
+	uint64_t best = 0;
+	llvm_dsp *instance = createCDSPInstance(factory);
 
-	DBG(handle, "[%s] %s %f", __func__, label, *zone);
+	if(!instance)
+	{
+		return 0;
+	}
 
-	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_BUTTON, label);
-	if(!cntrl)
+	instanceInitCDSPInstance(instance, handle->srate);
+	_tune_bench_ui(instance);
+
+	// benchmark at the length the DSP will actually be rendered with
+	const uint32_t nframes = handle->state.block_length
+		? (uint32_t)handle->state.block_length
+		: handle->max_block_length;
+	const uint32_t nins = getNumInputsCDSPInstance(instance);
+	const uint32_t nouts = getNumOutputsCDSPInstance(instance);
+	const uint32_t nchannels = nins + nouts;
+	FAUSTFLOAT **io = calloc(nchannels + 1, sizeof(FAUSTFLOAT *));
+	FAUSTFLOAT *buf = calloc((size_t)(nchannels + 1) * nframes, sizeof(FAUSTFLOAT));
+
+	if(io && buf)
 	{
-		return;
+		uint32_t seed = 0x12345678;
+
+		for(uint32_t i = 0; i < nchannels; i++)
+		{
+			io[i] = &buf[i * nframes];
+		}
+
+		// white noise in [-0.5, 0.5) as synthetic input
+		for(uint32_t i = 0; i < nins * nframes; i++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			buf[i] = (float)(seed >> 8) / (1 << 24) - 0.5f;
+		}
+
+		for(uint32_t i = 0; i < TUNE_WARMUP; i++)
+		{
+			computeCDSPInstance(instance, nframes, io, io + nins);
+		}
+
+		for(uint32_t r = 0; r < TUNE_ROUNDS; r++)
+		{
+			const uint64_t t0 = _clock_ns();
+
+			for(uint32_t i = 0; i < TUNE_BLOCKS; i++)
+			{
+				computeCDSPInstance(instance, nframes, io, io + nins);
+			}
+
+			const uint64_t dt = (_clock_ns() - t0) / TUNE_BLOCKS;
+
+			if( (best == 0) || (dt < best) )
+			{
+				best = dt ? dt : 1;
+			}
+		}
 	}
 
-	cntrl->zone = zone;
+	free(buf);
+	free(io);
+	deleteCDSPInstance(instance);
+
+	return best;
 }
 
+// non-rt thread, compiles and benchmarks a single variant, keeps it as
+// winner when faster than the current one
 static void
-_ui_add_check_button(void* iface, const char* label, FAUSTFLOAT* zone)
+_tune_variant(plughandle_t *handle, bool parallel, const char *options,
+	const char *variant, const char *code, factory_t **best, uint64_t *best_dt,
+	char *winner, LV2_Worker_Respond_Function respond,
+	LV2_Worker_Respond_Handle target)
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
+	char err [COMPILE_ERROR_SIZE];
+	args_t args;
 
-	DBG(handle, "[%s] %s %f", __func__, label, *zone);
+	memset(err, 0x0, sizeof(err));
+	_args_init(handle, &args, parallel, options, variant, code);
 
-	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_CHECK_BUTTON, label);
-	if(!cntrl)
+	factory_t *factory = _factory_attach(handle, code, args.argc, args.argv,
+		args.machine, err, respond, target);
+
+	if(!factory)
 	{
+		if(handle->log)
+		{
+			lv2_log_note(&handle->logger, "[%s] %s: %s", __func__, variant, err);
+		}
+
 		return;
 	}
 
-	cntrl->zone = zone;
+	const uint64_t dt = _tune_bench(handle, factory->factory);
+
+	if(handle->log)
+	{
+		lv2_log_note(&handle->logger, "[%s] %s: %.1f us/block", __func__, variant,
+			dt * 1e-3);
+	}
+
+	if(dt && ( (*best_dt == 0) || (dt < *best_dt) ) )
+	{
+		if(*best)
+		{
+			_factory_detach(*best);
+		}
+
+		*best = factory;
+		*best_dt = dt;
+		snprintf(winner, OPTIONS_SIZE, "%s", variant);
+	}
+	else
+	{
+		_factory_detach(factory);
+	}
 }
 
+// non-rt thread
 static void
-_ui_add_vertical_slider(void* iface, const char* label, FAUSTFLOAT* zone,
-	FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
+_tune_serial(plughandle_t *handle, const char *options, const char *winner,
+	const char *code, uint64_t parallel_dt, LV2_Worker_Respond_Function respond,
+	LV2_Worker_Respond_Handle target)
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
+	char err [COMPILE_ERROR_SIZE];
+	args_t args;
 
-	DBG(handle, "[%s] %s %f %f %f %f %f", __func__,
-		label, *zone, init, min, max, step);
+	memset(err, 0x0, sizeof(err));
+	_args_init(handle, &args, false, options, winner, code);
 
-	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_VERTICAL_SLIDER, label);
-	if(!cntrl)
+	factory_t *factory = _factory_attach(handle, code, args.argc, args.argv,
+		args.machine, err, respond, target);
+
+	if(!factory)
 	{
 		return;
 	}
 
-	cntrl->zone = zone;
-	cntrl->vertical_slider.init = init;
-	cntrl->vertical_slider.min = min;
-	cntrl->vertical_slider.max = max;
-	cntrl->vertical_slider.ran = max - min;
-	cntrl->vertical_slider.step = step;
+	const uint64_t dt = _tune_bench(handle, factory->factory);
+
+	if(dt && parallel_dt && handle->log)
+	{
+		lv2_log_note(&handle->logger,
+			"[%s] single-threaded: %.1f us/block, parallel speedup: x%.2f%s",
+			__func__, dt * 1e-3, (double)dt / parallel_dt,
+			(dt < parallel_dt) ? ", consider disabling parallel execution" : "");
+	}
+
+	_factory_detach(factory);
 }
 
-static void
-_ui_add_horizontal_slider(void* iface, const char* label, FAUSTFLOAT* zone,
-	FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
+// non-rt thread, benchmarks compile option variants of the current code,
+// returns the winning options or NULL
+static char *
+_tune(plughandle_t *handle,
+	LV2_Worker_Respond_Function respond, LV2_Worker_Respond_Handle target)
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
+	char winner [OPTIONS_SIZE];
+	char variant [OPTIONS_SIZE];
+	factory_t *best = NULL;
+	uint64_t best_dt = 0;
 
-	DBG(handle, "[%s] %s %f %f %f %f %f", __func__,
-		label, *zone, init, min, max, step);
+	_payload_adopt(handle);
 
-	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_HORIZONTAL_SLIDER, label);
-	if(!cntrl)
+	if(!handle->payload)
 	{
-		return;
+		return NULL;
 	}
 
-	cntrl->zone = zone;
-	cntrl->horizontal_slider.init = init;
-	cntrl->horizontal_slider.min = min;
-	cntrl->horizontal_slider.max = max;
-	cntrl->horizontal_slider.ran = max - min;
-	cntrl->horizontal_slider.step = step;
+	// previously tuned options are ignored
+	bool parallel;
+	const char *options;
+	const char *tuned;
+	const char *code = _payload_parse(handle->payload, &parallel, &options,
+		&tuned);
+
+	for(const char **ptr = tune_variants; *ptr; ptr++)
+	{
+		if(_superseded(handle))
+		{
+			goto superseded;
+		}
+
+		_tune_variant(handle, parallel, options, *ptr, code, &best, &best_dt,
+			winner, respond, target);
+	}
+
+	if(!best)
+	{
+		return NULL;
+	}
+
+	if(_superseded(handle))
+	{
+		goto superseded;
+	}
+
+	// try the winner with deep-first scheduling, too
+	snprintf(variant, sizeof(variant), "%s -dfs", winner);
+	_tune_variant(handle, parallel, options, variant, code, &best, &best_dt,
+		winner, respond, target);
+
+	if(handle->log)
+	{
+		lv2_log_note(&handle->logger, "[%s] winner: %s (%.1f us/block)", __func__,
+			winner, best_dt * 1e-3);
+	}
+
+	// the scheduler only pays off for wide signal graphs, compare against
+	// single-threaded execution of the winner
+	if(parallel && !_superseded(handle))
+	{
+		_tune_serial(handle, options, winner, code, best_dt, respond, target);
+	}
+
+	// keep the winning factory alive until the normal path picked it up
+	if(handle->tuned)
+	{
+		_factory_detach(handle->tuned);
+	}
+	handle->tuned = best;
+
+	return strdup(winner);
+
+superseded:
+	if(best)
+	{
+		_factory_detach(best);
+	}
+
+	if(handle->log)
+	{
+		lv2_log_note(&handle->logger, "[%s] superseded by newer code", __func__);
+	}
+
+	return NULL;
 }
 
 static void
-_ui_add_num_entry(void* iface, const char* label, FAUSTFLOAT* zone,
-	FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step)
+cleanup(LV2_Handle instance)
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
+	plughandle_t *handle = instance;
 
-	DBG(handle, "[%s] %s %f %f %f %f %f", __func__,
-		label, *zone, init, min, max, step);
+	munlock(handle, sizeof(plughandle_t));
+	varchunk_free(handle->to_worker);
+	_dsp_deinit(handle, handle->dsp[0]);
+	_dsp_deinit(handle, handle->dsp[1]);
+	_dsp_deinit(handle, handle->held_dsp);
+	if(handle->tuned)
+	{
+		_factory_detach(handle->tuned);
+	}
+	free(handle->payload);
+	free(atomic_load(&handle->restored_payload));
+	_dsp_deinit(handle, atomic_load(&handle->restored_dsp));
+	_voice_pool_free(handle->pool);
+	free(handle->tuning);
+	_buffers_deinit(handle);
+	free(handle);
+}
+
+static const char *
+_state_string(plughandle_t *handle, LV2_State_Retrieve_Function retrieve,
+	LV2_State_Handle state, LV2_URID property, size_t *size)
+{
+	uint32_t type;
+	uint32_t flags;
+	const char *body = retrieve(state, property, size, &type, &flags);
 
-	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_NUM_ENTRY, label);
-	if(!cntrl)
+	if(!body || (type != handle->forge.String) || (*size == 0)
+		|| (body[*size - 1] != '\0') )
 	{
-		return;
+		return NULL;
 	}
 
-	cntrl->zone = zone;
-	cntrl->num_entry.init = init;
-	cntrl->num_entry.min = min;
-	cntrl->num_entry.max = max;
-	cntrl->num_entry.ran = max - min;
-	cntrl->num_entry.step = step;
+	return body;
 }
 
-static void
-_ui_add_horizontal_bargraph(void* iface, const char* label, FAUSTFLOAT* zone,
-	FAUSTFLOAT min, FAUSTFLOAT max)
+static bool
+_state_bool(plughandle_t *handle, LV2_State_Retrieve_Function retrieve,
+	LV2_State_Handle state, LV2_URID property)
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
-
-	DBG(handle, "[%s] %s %f %f %f", __func__,
-		label, *zone, min, max);
+	size_t size;
+	uint32_t type;
+	uint32_t flags;
+	const int32_t *body = retrieve(state, property, &size, &type, &flags);
 
-	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_HORIZONTAL_BARGRAPH, label);
-	if(!cntrl)
+	if(!body || (type != handle->forge.Bool) || (size != sizeof(int32_t)) )
 	{
-		return;
+		return false;
 	}
 
-	cntrl->zone = zone;
-	cntrl->readonly = true;
-	cntrl->horizontal_bargraph.min = min;
-	cntrl->horizontal_bargraph.max = max;
-	cntrl->horizontal_bargraph.ran_1 = 1.f / (max - min);
+	return *body;
 }
 
-static void
-_ui_add_vertical_bargraph(void* iface, const char* label, FAUSTFLOAT* zone,
-	FAUSTFLOAT min, FAUSTFLOAT max)
+// state restore thread, there is nobody to respond to
+static LV2_Worker_Status
+_state_respond(LV2_Worker_Respond_Handle target __attribute__((unused)),
+	uint32_t size __attribute__((unused)), const void *body)
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
-
-	DBG(handle, "[%s] %s %f %f %f", __func__,
-		label, *zone, min, max);
+	const job_t *job = body;
 
-	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_VERTICAL_BARGRAPH, label);
-	if(!cntrl)
+	if( (job->type == JOB_TYPE_ERROR_APPEND) && job->error)
 	{
-		return;
+		free(job->error);
 	}
 
-	cntrl->zone = zone;
-	cntrl->readonly = true;
-	cntrl->vertical_bargraph.min = min;
-	cntrl->vertical_bargraph.max = max;
-	cntrl->vertical_bargraph.ran_1 = 1.f / (max - min);
+	return LV2_WORKER_SUCCESS;
 }
 
+// state restore thread, compiles the restored code right away and hands it to
+// the rt-thread, falls back to the worker on failure
 static void
-_ui_add_sound_file(void* iface, const char* label, const char* filename,
-	struct Soundfile** sf_zone __attribute__((unused)))
+_state_compile(plughandle_t *handle, LV2_State_Retrieve_Function retrieve,
+	LV2_State_Handle state)
 {
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
-
-	DBG(handle, "[%s] %s %s", __func__,
-		label, filename);
-
-	cntrl_t *cntrl = _ui_next_cntrl(dsp, CNTRL_SOUND_FILE, label);
-	if(!cntrl)
+	size_t code_size = 0;
+	size_t options_size = 0;
+	size_t tuned_size = 0;
+	args_t args;
+
+	const char *code = _state_string(handle, retrieve, state,
+		handle->mephisto_code, &code_size);
+	const char *options = _state_string(handle, retrieve, state,
+		handle->mephisto_compileOptions, &options_size);
+	const char *tuned = _state_string(handle, retrieve, state,
+		handle->mephisto_tunedOptions, &tuned_size);
+
+	if(!code || (code_size > CODE_SIZE) )
 	{
 		return;
 	}
 
-	//FIXME
-}
-
-static void
-_ui_declare(void* iface, FAUSTFLOAT* zone __attribute__((unused)),
-	const char* key, const char* value)
-{
-	dsp_t *dsp = iface;
-	plughandle_t *handle = dsp->handle;
+	if(!options || (options_size > OPTIONS_SIZE) )
+	{
+		options = COMPILE_OPTIONS_DEFAULT;
+	}
 
-	DBG(handle, "[%s] %s %s", __func__,
-		key, value);
+	const char *parallel = _payload_parallel(_state_bool(handle, retrieve, state,
+		handle->mephisto_parallel));
+	const size_t parallel_size = strlen(parallel) + 1;
+	options_size = strlen(options) + 1;
 
-	if(!strcasecmp(value, ""))
+	if(!tuned || (tuned_size > OPTIONS_SIZE) )
 	{
-		char *endptr = NULL;
-		const long int idx = strtol(key, &endptr, 10);
-
-		if(endptr != key)
-		{
-			dsp->idx = idx;
-		}
-		else if(handle->log)
-		{
-			lv2_log_error(&handle->logger, "[%s] invalid index key %s",
-				__func__, key);
-		}
+		tuned = "";
+		tuned_size = 1;
 	}
-	else if(!strcasecmp(key, "time"))
+
+	// keep a copy for the worker, e.g. for auto-tuning
+	char *payload = malloc(parallel_size + options_size + tuned_size
+		+ code_size);
+	dsp_t *dsp = calloc(1, sizeof(dsp_t));
+
+	if(!payload || !dsp)
 	{
-		if(!strcasecmp(value, "barBeat"))
-		{
-			dsp->timely_mask = TIMELY_MASK_BAR_BEAT;
-		}
-		else if(!strcasecmp(value, "bar"))
-		{
-			dsp->timely_mask = TIMELY_MASK_BAR;
-		}
-		else if(!strcasecmp(value, "beatUnit"))
-		{
-			dsp->timely_mask = TIMELY_MASK_BEAT_UNIT;
-		}
-		else if(!strcasecmp(value, "beatsPerBar"))
-		{
-			dsp->timely_mask = TIMELY_MASK_BEATS_PER_BAR;
-		}
-		else if(!strcasecmp(value, "beatsPerMinute"))
-		{
-			dsp->timely_mask = TIMELY_MASK_BEATS_PER_MINUTE;
-		}
-		else if(!strcasecmp(value, "frame"))
-		{
-			dsp->timely_mask = TIMELY_MASK_FRAME;
-		}
-		else if(!strcasecmp(value, "framesPerSecond"))
-		{
-			dsp->timely_mask = TIMELY_MASK_FRAMES_PER_SECOND;
-		}
-		else if(!strcasecmp(value, "speed"))
-		{
-			dsp->timely_mask = TIMELY_MASK_SPEED;
-		}
-		else if(handle->log)
-		{
-			lv2_log_error(&handle->logger, "[%s] invalid time value %s",
-				__func__, value);
-		}
+		free(payload);
+		free(dsp);
+		return;
 	}
-	else if(handle->log)
+
+	_payload_append(_payload_append(_payload_append(_payload_append(payload,
+		parallel, parallel_size), options, options_size), tuned, tuned_size),
+		code, code_size);
+
+	restoring = true;
+	_args_init(handle, &args, parallel[0] != '\0', options, tuned, code);
+	const int status = _dsp_init(handle, dsp, TIER_LLVM, code, &args,
+		_state_respond, NULL);
+	restoring = false;
+
+	if(status != 0)
 	{
-			lv2_log_note(&handle->logger, "[%s] unknown key:value pair %s:%s",
-				__func__, key, value);
+		_dsp_deinit(handle, dsp);
+		free(payload);
+		return;
 	}
+
+	// a previous one not yet picked up by the rt-thread is ours to free
+	_dsp_deinit(handle, atomic_exchange_explicit(&handle->restored_dsp, dsp,
+		memory_order_release));
+	free(atomic_exchange_explicit(&handle->restored_payload, payload,
+		memory_order_release));
 }
 
-static int
-_meta_init(dsp_t *dsp, voice_t *base_voice)
+static LV2_State_Status
+_state_save(LV2_Handle instance, LV2_State_Store_Function store,
+	LV2_State_Handle state, uint32_t flags,
+	const LV2_Feature *const *features)
 {
-	MetaGlue *glue = &dsp->meta_glue;
+	plughandle_t *handle = instance;
 
-	glue->metaInterface = dsp;
+	return props_save(&handle->props, store, state, flags, features);
+}
 
-	glue->declare = _meta_declare;
+static LV2_State_Status
+_state_restore(LV2_Handle instance, LV2_State_Retrieve_Function retrieve,
+	LV2_State_Handle state, uint32_t flags,
+	const LV2_Feature *const *features)
+{
+	plughandle_t *handle = instance;
 
-	dsp->nvoices = 1; // assume we're a filter by default
-	dsp->timely_mask = 0;
-	dsp->idx = -1;
+	_state_compile(handle, retrieve, state);
+
+	return props_restore(&handle->props, retrieve, state, flags, features);
+}
 
-	metadataCDSPInstance(base_voice->instance, glue);
+static const LV2_State_Interface state_iface = {
+	.save = _state_save,
+	.restore = _state_restore
+};
 
-	return 0;
+// non-rt thread
+// semitone and 14-bit fraction thereof
+static inline float
+_mts2cps(uint8_t xx, uint8_t yy, uint8_t zz)
+{
+	return _midi2cps(xx + ( (yy << 7) | zz) * 0x1p-14);
 }
 
+// bulk dump, single note tuning change and 1-byte scale/octave tuning
 static int
-_ui_init(dsp_t *dsp)
+_tuning_mts(tuning_t *tuning, const uint8_t *msg, uint32_t len)
 {
-	UIGlue *glue = &dsp->ui_glue;
+	const bool realtime = (msg[1] == 0x7f);
 
-	glue->uiInterface = dsp;
+	switch(msg[4])
+	{
+		case 0x01: // bulk dump
+		{
+			if(realtime || (len < MTS_BULK_SIZE) )
+			{
+				return -1;
+			}
 
-	glue->openTabBox = _ui_open_tab_box;
-	glue->openHorizontalBox = _ui_open_horizontal_box;
-	glue->openVerticalBox = _ui_open_vertical_box;
-	glue->closeBox = _ui_close_box;
-	glue->addButton = _ui_add_button;
-	glue->addCheckButton = _ui_add_check_button;
-	glue->addVerticalSlider = _ui_add_vertical_slider;
-	glue->addHorizontalSlider = _ui_add_horizontal_slider;
-	glue->addNumEntry = _ui_add_num_entry;
-	glue->addHorizontalBargraph = _ui_add_horizontal_bargraph;
-	glue->addVerticalBargraph = _ui_add_vertical_bargraph;
-	glue->FAUST_ADDSOUNDFILE= _ui_add_sound_file;
-	glue->declare = _ui_declare;
+			for(uint32_t key = 0; key < 0x80; key++)
+			{
+				const uint8_t *dat = &msg[22 + 3*key];
+
+				if( (dat[0] == 0x7f) && (dat[1] == 0x7f) && (dat[2] == 0x7f) )
+				{
+					continue; // no change
+				}
 
-	dsp->cvoices = 0;
+				const float freq = _mts2cps(dat[0], dat[1], dat[2]);
 
-	VOICE_FOREACH(dsp, voice)
-	{
-		if(voice->instance)
+				for(uint32_t chn = 0; chn < 0x10; chn++)
+				{
+					tuning->freq[chn][key] = freq;
+				}
+			}
+		} return 0;
+		case 0x02: // single note tuning change
 		{
-			buildUserInterfaceCDSPInstance(voice->instance, glue);
-		}
+			if(!realtime || (len < 8) || (len < 8 + 4u*msg[6]) )
+			{
+				return -1;
+			}
 
-		dsp->cvoices++;
-	}
+			for(uint32_t i = 0; i < msg[6]; i++)
+			{
+				const uint8_t *dat = &msg[7 + 4*i];
+				const uint8_t key = dat[0] & 0x7f;
 
-	return 0;
-}
+				if( (dat[1] == 0x7f) && (dat[2] == 0x7f) && (dat[3] == 0x7f) )
+				{
+					continue; // no change
+				}
 
-static int
-_dsp_init(plughandle_t *handle, dsp_t *dsp, const char *code,
-	LV2_Worker_Respond_Function respond, LV2_Worker_Respond_Handle target)
-{
-#define ARGC 5
-	char err [4096];
+				const float freq = _mts2cps(dat[1], dat[2], dat[3]);
 
-	const char *argv [ARGC] = {
-		"-I", handle->dsp_dir,
-		"-vec",
-		"-lv", "1"
-	};
+				for(uint32_t chn = 0; chn < 0x10; chn++)
+				{
+					tuning->freq[chn][key] = freq;
+				}
+			}
+		} return 0;
+		case 0x08: // scale/octave tuning, 1-byte form
+		{
+			if(len < 21)
+			{
+				return -1;
+			}
 
-	{
-		const job_t job = {
-			.type = JOB_TYPE_ERROR_CLEAR,
-			.error = NULL
-		};
+			const uint16_t mask = ( (msg[5] & 0x03) << 14)
+				| ( (msg[6] & 0x7f) << 7)
+				| (msg[7] & 0x7f);
 
-		respond(target, sizeof(job), &job);
+			for(uint32_t chn = 0; chn < 0x10; chn++)
+			{
+				if(!(mask & (1 << chn)))
+				{
+					continue;
+				}
+
+				for(uint32_t key = 0; key < 0x80; key++)
+				{
+					const int8_t cents = msg[8 + key % 12] - 0x40;
+
+					tuning->freq[chn][key] = key_freq[key] * exp2f(cents / 1200.f);
+				}
+			}
+		} return 0;
 	}
 
-	dsp->handle = handle;
-	memset(err, 0x0, sizeof(err));
+	return -1;
+}
 
-	pthread_mutex_lock(&lock);
+// a ratio (3/2, 2) or a value in cents (701.955), as frequency factor
+static int
+_scala_pitch(const char *line, double *factor)
+{
+	char *end;
 
-	dsp->factory = createCDSPFactoryFromString("mephisto", code, ARGC, argv, "", err, -1);
-	if(!dsp->factory)
+	if(strchr(line, '.'))
 	{
-		if(handle->log)
+		const double cents = strtod(line, &end);
+
+		if(end == line)
 		{
-			lv2_log_error(&handle->logger, "[%s] %s", __func__, err);
+			return -1;
+		}
 
-			const job_t job = {
-				.type = JOB_TYPE_ERROR_APPEND,
-				.error = strdup(err)
-			};
+		*factor = exp2(cents / 1200.0);
 
-			respond(target, sizeof(job), &job);
-		}
+		return 0;
+	}
 
-		goto fail;
+	const long num = strtol(line, &end, 10);
+	long den = 1;
+
+	if(end == line)
+	{
+		return -1;
 	}
 
-	voice_t *base_voice = _voice_begin(dsp);
-	base_voice->instance = createCDSPInstance(dsp->factory);
-	if(!base_voice->instance)
+	if(*end == '/')
 	{
-		if(handle->log)
+		const char *str = end + 1;
+
+		den = strtol(str, &end, 10);
+
+		if(end == str)
 		{
-			lv2_log_error(&handle->logger, "[%s] instance creation failed", __func__);
+			return -1;
 		}
+	}
 
-		deleteCDSPFactory(dsp->factory);
-		goto fail;
+	if( (num <= 0) || (den <= 0) )
+	{
+		return -1;
 	}
 
-	instanceInitCDSPInstance(base_voice->instance, handle->srate);
+	*factor = (double)num / den;
 
-	dsp->nins = getNumInputsCDSPInstance(base_voice->instance);
-	dsp->nouts = getNumInputsCDSPInstance(base_voice->instance);
+	return 0;
+}
 
-	if(_meta_init(dsp, base_voice) != 0)
+// Scala scale file, degree 0 is mapped to middle C in 12-TET on all channels
+static int
+_tuning_scala(plughandle_t *handle, tuning_t *tuning, const char *path)
+{
+	FILE *file = fopen(path, "r");
+
+	if(!file)
 	{
 		if(handle->log)
 		{
-			lv2_log_error(&handle->logger, "[%s] meta creation failed", __func__);
+			lv2_log_error(&handle->logger, "[%s] failed to open '%s'", __func__,
+				path);
 		}
 
-		deleteCDSPFactory(dsp->factory);
-		goto fail;
+		return -1;
 	}
 
-	dsp->is_instrument = (dsp->nvoices > 1);
+	double factors [SCALA_NOTES_MAX + 1] = { [0] = 1.0 };
+	uint32_t nnotes = 0;
+	uint32_t npitches = 0;
+	uint32_t nlines = 0;
+	char line [0x100];
 
-	if(dsp->is_instrument)
+	while(fgets(line, sizeof(line), file))
 	{
-		VOICE_FOREACH(dsp, voice)
+		const char *str = line + strspn(line, " \t");
+
+		if(str[0] == '!')
 		{
-			if(voice == base_voice) // skip base voice
-			{
-				continue;
-			}
+			continue; // comment
+		}
 
-			voice->instance = cloneCDSPInstance(base_voice->instance);
-			if(!voice->instance)
+		switch(nlines++)
+		{
+			case 0: // description
+			{
+				// nothing to do
+			} break;
+			case 1: // number of notes
+			{
+				nnotes = strtoul(str, NULL, 10);
+			} break;
+			default: // pitch
 			{
-				if(handle->log)
+				if( (npitches < SCALA_NOTES_MAX)
+					&& (_scala_pitch(str, &factors[npitches + 1]) == 0) )
 				{
-					lv2_log_error(&handle->logger, "[%s] instance creation failed", __func__);
+					npitches++;
 				}
+			} break;
+		}
 
-				break;
-			}
-
-			instanceInitCDSPInstance(voice->instance, handle->srate);
+		if( (nlines > 1) && (npitches >= nnotes) )
+		{
+			break;
 		}
 	}
-	else
-	{
-		base_voice->state = VOICE_STATE_ACTIVE;
-	}
 
-	if(_ui_init(dsp) != 0)
+	fclose(file);
+
+	if( (nnotes == 0) || (nnotes > SCALA_NOTES_MAX) || (npitches < nnotes) )
 	{
 		if(handle->log)
 		{
-			lv2_log_error(&handle->logger, "[%s] ui creation failed", __func__);
+			lv2_log_error(&handle->logger, "[%s] invalid scale '%s'", __func__,
+				path);
 		}
 
-		deleteCDSPFactory(dsp->factory);
-		goto fail;
-	}
-
-	if(handle->log)
-	{
-		lv2_log_note(&handle->logger,
-			"[%s] compilation succeeded (ins: %u, outs: %u, type: %s)", __func__,
-			dsp->nins, dsp->nouts, dsp->is_instrument ? "instrument" : "filter");
+		return -1;
 	}
 
-	pthread_mutex_unlock(&lock);
-	return 0;
-
-fail:
-	pthread_mutex_unlock(&lock);
-	return 1;
-#undef ARGC
-}
+	// the last pitch is the period, e.g. the octave
+	const double period = factors[nnotes];
+	const int32_t root = 60;
 
-static void
-_dsp_deinit(plughandle_t *handle __attribute__((unused)), dsp_t *dsp)
-{
-	if(dsp)
+	for(int32_t key = 0; key < 0x80; key++)
 	{
-		pthread_mutex_lock(&lock);
-
-		VOICE_FOREACH(dsp, voice)
+		const int32_t steps = key - root;
+		const int32_t octave = (steps >= 0)
+			? steps / (int32_t)nnotes
+			: -( (-steps + (int32_t)nnotes - 1) / (int32_t)nnotes);
+		const int32_t degree = steps - octave*(int32_t)nnotes;
+		const float freq = key_freq[root] * pow(period, octave) * factors[degree];
+
+		for(uint32_t chn = 0; chn < 0x10; chn++)
 		{
-			if(voice->instance)
-			{
-				instanceClearCDSPInstance(voice->instance);
-				deleteCDSPInstance(voice->instance);
-			}
-		}
-
-		if(dsp->factory)
-		{
-			deleteCDSPFactory(dsp->factory);
+			tuning->freq[chn][key] = freq;
 		}
+	}
 
-		pthread_mutex_unlock(&lock);
+	if(handle->log)
+	{
+		lv2_log_note(&handle->logger, "[%s] %"PRIu32" notes from '%s'", __func__,
+			nnotes, path);
 	}
+
+	return 0;
 }
 
+// worker-thread, hands a copy of the edited tuning over to the rt-thread
 static void
-cleanup(LV2_Handle instance)
+_tuning_respond(plughandle_t *handle, LV2_Worker_Respond_Function respond,
+	LV2_Worker_Respond_Handle target)
 {
-	plughandle_t *handle = instance;
-
-	munlock(handle, sizeof(plughandle_t));
-	varchunk_free(handle->to_worker);
-	_dsp_deinit(handle, handle->dsp[0]);
-	_dsp_deinit(handle, handle->dsp[1]);
-	free(handle);
-}
+	tuning_t *tuning = malloc(sizeof(tuning_t));
 
-static LV2_State_Status
-_state_save(LV2_Handle instance, LV2_State_Store_Function store,
-	LV2_State_Handle state, uint32_t flags,
-	const LV2_Feature *const *features)
-{
-	plughandle_t *handle = instance;
+	if(!tuning)
+	{
+		return;
+	}
 
-	return props_save(&handle->props, store, state, flags, features);
-}
+	memcpy(tuning, &handle->tuning_edit, sizeof(tuning_t));
 
-static LV2_State_Status
-_state_restore(LV2_Handle instance, LV2_State_Retrieve_Function retrieve,
-	LV2_State_Handle state, uint32_t flags,
-	const LV2_Feature *const *features)
-{
-	plughandle_t *handle = instance;
+	const job_t job = {
+		.type = JOB_TYPE_TUNING,
+		.tuning = tuning
+	};
 
-	return props_restore(&handle->props, retrieve, state, flags, features);
+	respond(target, sizeof(job), &job);
 }
 
-static const LV2_State_Interface state_iface = {
-	.save = _state_save,
-	.restore = _state_restore
-};
-
-// non-rt thread
 static LV2_Worker_Status
 _work(LV2_Handle instance,
 	LV2_Worker_Respond_Function respond,
@@ -2386,32 +7177,95 @@ _work(LV2_Handle instance,
 {
 	plughandle_t *handle = instance;
 
-	if(body_size != sizeof(job_t))
+	if(body_size < sizeof(job_t))
 	{
 		return LV2_WORKER_ERR_UNKNOWN;
 	}
 
 	const job_t *job = body;
+	const bool has_payload = (job->type == JOB_TYPE_SCALA)
+		|| (job->type == JOB_TYPE_MTS);
+
+	if(body_size != sizeof(job_t) + (has_payload ? job->size : 0))
+	{
+		return LV2_WORKER_ERR_UNKNOWN;
+	}
+
 	switch(job->type)
 	{
 		case JOB_TYPE_INIT:
 		{
 			size_t size;
-			const char *code;
-			while( (code= varchunk_read_request(handle->to_worker, &size)) )
+			const char *chunk;
+			args_t args;
+			dsp_t *grow = NULL;
+
+			_payload_adopt(handle);
+
+			// only ever compile the latest code, retry when superseded meanwhile
+			while( (chunk = varchunk_read_request(handle->to_worker, &size)) )
 			{
-				dsp_t *dsp = calloc(1, sizeof(dsp_t));
-				if(dsp && (_dsp_init(handle, dsp, code, respond, target) == 0) )
+				do {
+					free(handle->payload);
+					handle->payload = malloc(size);
+					if(handle->payload)
+					{
+						memcpy(handle->payload, chunk, size);
+					}
+					varchunk_read_advance(handle->to_worker);
+				} while( (chunk = varchunk_read_request(handle->to_worker, &size)) );
+
+				if(!handle->payload)
 				{
-					const job_t job2 = {
-						.type = JOB_TYPE_INIT,
-						.dsp = dsp
-					};
+					break;
+				}
+
+				bool parallel;
+				const char *options;
+				const char *tuned;
+				const char *code = _payload_parse(handle->payload, &parallel, &options,
+					&tuned);
+
+				_args_init(handle, &args, parallel, options, tuned, code);
+
+#if defined(_FAUST_HAS_INTERPRETER)
+				// run interpreted code while JIT compiling, unless JIT code is at hand
+				if(handle->state.tiered
+					&& !_factory_hot(handle, code, args.argc, args.argv, args.machine) )
+				{
+					dsp_t *dsp = _dsp_compile(handle, TIER_INTERPRETER, code, &args,
+						respond, target);
+
+					if(dsp)
+					{
+						grow = dsp;
+					}
+				}
+#endif
+
+				if(!_superseded(handle))
+				{
+					dsp_t *dsp = _dsp_compile(handle, TIER_LLVM, code, &args,
+						respond, target);
 
-					respond(target, sizeof(job2), &job2);
+					if(dsp)
+					{
+						grow = dsp;
+					}
 				}
+			}
+
+			// only grow the latest dsp handed over, older ones are on their way out
+			if(grow)
+			{
+				_dsp_grow(handle, grow);
+			}
 
-				varchunk_read_advance(handle->to_worker);
+			// the tuner's winning factory is not needed beyond the next compilation
+			if(handle->tuned)
+			{
+				_factory_detach(handle->tuned);
+				handle->tuned = NULL;
 			}
 		} break;
 		case JOB_TYPE_DEINIT:
@@ -2434,6 +7288,87 @@ _work(LV2_Handle instance,
 				free(job->error);
 			}
 		} break;
+		case JOB_TYPE_QUEUE:
+		{
+			// never reached
+		} break;
+		case JOB_TYPE_TUNE:
+		{
+			const job_t job2 = {
+				.type = JOB_TYPE_TUNE,
+				.options = _tune(handle, respond, target)
+			};
+
+			respond(target, sizeof(job2), &job2);
+		} break;
+		case JOB_TYPE_TUNE_FREE:
+		{
+			if(job->options)
+			{
+				free(job->options);
+			}
+		} break;
+		case JOB_TYPE_POOL:
+		{
+			voice_pool_t *vpool = NULL;
+
+			// a single lane is rendered on the audio thread without any pool
+			if(job->nlanes > 1)
+			{
+				vpool = _voice_pool_new(handle, job->nlanes);
+
+				if(!vpool && handle->log)
+				{
+					lv2_log_error(&handle->logger, "[%s] failed to spawn %"PRIu32
+						" voice threads", __func__, job->nlanes - 1);
+				}
+			}
+
+			const job_t job2 = {
+				.type = JOB_TYPE_POOL,
+				.pool = vpool
+			};
+
+			respond(target, sizeof(job2), &job2);
+		} break;
+		case JOB_TYPE_POOL_FREE:
+		{
+			_voice_pool_free(job->pool);
+		} break;
+		case JOB_TYPE_SCALA:
+		{
+			const char *path = (const char *)&job[1];
+
+			if(path[0] == '\0')
+			{
+				_tuning_reset(&handle->tuning_edit);
+			}
+			else if(_tuning_scala(handle, &handle->tuning_edit, path) != 0)
+			{
+				break;
+			}
+
+			_tuning_respond(handle, respond, target);
+		} break;
+		case JOB_TYPE_MTS:
+		{
+			const uint8_t *msg = (const uint8_t *)&job[1];
+
+			if(_tuning_mts(&handle->tuning_edit, msg, job->size) != 0)
+			{
+				break;
+			}
+
+			_tuning_respond(handle, respond, target);
+		} break;
+		case JOB_TYPE_TUNING:
+		{
+			// never reached
+		} break;
+		case JOB_TYPE_TUNING_FREE:
+		{
+			free(job->tuning);
+		} break;
 		default:
 		{
 			// never reached
@@ -2459,60 +7394,7 @@ _work_response(LV2_Handle instance, uint32_t size, const void *body)
 	{
 		case JOB_TYPE_INIT:
 		{
-			const job_t job2 = {
-				.type = JOB_TYPE_DEINIT,
-				.dsp = handle->dsp[!handle->play]
-			};
-			handle->sched->schedule_work(handle->sched->handle, sizeof(job2), &job2);
-
-			handle->dsp[!handle->play] = job->dsp;
-			handle->xfade_cur = handle->xfade_max;
-
-			for(uint32_t i = 0; i < NCONTROLS; i++)
-			{
-				_refresh_value(handle, i);
-				_refresh_attributes(handle, i);
-			}
-
-			dsp_t *cur_dsp = handle->dsp[handle->play];
-			dsp_t *new_dsp = handle->dsp[!handle->play];
-
-			if(cur_dsp && new_dsp)
-			{
-				voice_t *cur_voice = _voice_begin(cur_dsp);
-
-				VOICE_FOREACH(new_dsp, new_voice)
-				{
-					_cntrl_refresh_value_abs(&new_voice->freq,
-						_cntrl_get_value_abs(&cur_voice->freq));
-					_cntrl_refresh_value_abs(&new_voice->pressure,
-						_cntrl_get_value_abs(&cur_voice->pressure));
-					_cntrl_refresh_value_abs(&new_voice->timbre,
-						_cntrl_get_value_abs(&cur_voice->timbre));
-					_cntrl_refresh_value_abs(&new_voice->d_freq,
-						_cntrl_get_value_abs(&cur_voice->d_freq));
-					_cntrl_refresh_value_abs(&new_voice->d_pressure,
-						_cntrl_get_value_abs(&cur_voice->d_pressure));
-					_cntrl_refresh_value_abs(&new_voice->d_timbre,
-						_cntrl_get_value_abs(&cur_voice->d_timbre));
-					_cntrl_refresh_value_abs(&new_voice->gate,
-						_cntrl_get_value_abs(&cur_voice->gate));
-					_cntrl_refresh_value_abs(&new_voice->gain,
-						_cntrl_get_value_abs(&cur_voice->gain));
-
-					new_voice->state = cur_voice->state;
-					new_voice->hash = cur_voice->hash;
-
-					if(!_voice_not_end(cur_dsp, cur_voice))
-					{
-						break;
-					}
-
-					cur_voice = _voice_next(cur_voice);
-				}
-			}
-
-			handle->dirty.attributes = true;
+			_dsp_offer(handle, job->dsp);
 		} break;
 		case JOB_TYPE_DEINIT:
 		{
@@ -2555,6 +7437,102 @@ _work_response(LV2_Handle instance, uint32_t size, const void *body)
 		{
 			// never reached
 		} break;
+		case JOB_TYPE_QUEUE:
+		{
+			handle->state.compile_queue = job->depth;
+
+			handle->dirty.queue = true;
+		} break;
+		case JOB_TYPE_TUNE:
+		{
+			handle->state.auto_tune = false;
+
+			if(job->options)
+			{
+				_string_set(handle, handle->mephisto_tunedOptions,
+					handle->state.tuned_options, job->options);
+
+				// promote the winner via the normal path, it is readily compiled
+				_submit_code(handle);
+
+				const job_t job2 = {
+					.type = JOB_TYPE_TUNE_FREE,
+					.options = job->options
+				};
+
+				handle->sched->schedule_work(handle->sched->handle, sizeof(job2), &job2);
+			}
+
+			handle->dirty.tune = true;
+		} break;
+		case JOB_TYPE_TUNE_FREE:
+		{
+			// never reached
+		} break;
+		case JOB_TYPE_POOL:
+		{
+			if(handle->pool)
+			{
+				const job_t job2 = {
+					.type = JOB_TYPE_POOL_FREE,
+					.pool = handle->pool
+				};
+
+				handle->sched->schedule_work(handle->sched->handle, sizeof(job2), &job2);
+			}
+
+			handle->pool = job->pool;
+			handle->pool_frames = 0;
+			memset(handle->pool_busy, 0x0, sizeof(handle->pool_busy));
+
+			if(!handle->pool)
+			{
+				_string_set(handle, handle->mephisto_voiceLoad,
+					handle->state.voice_load, "");
+
+				handle->dirty.load = true;
+			}
+		} break;
+		case JOB_TYPE_POOL_FREE:
+		{
+			// never reached
+		} break;
+		case JOB_TYPE_SCALA:
+			// fall-through
+		case JOB_TYPE_MTS:
+		{
+			// never reached
+		} break;
+		case JOB_TYPE_TUNING:
+		{
+			const job_t job2 = {
+				.type = JOB_TYPE_TUNING_FREE,
+				.tuning = handle->tuning
+			};
+
+			handle->sched->schedule_work(handle->sched->handle, sizeof(job2), &job2);
+
+			handle->tuning = job->tuning;
+
+			for(uint32_t d = 0; d < 2; d++)
+			{
+				dsp_t *dsp = handle->dsp[d];
+
+				if(!dsp)
+				{
+					continue;
+				}
+
+				for(uint8_t c = 0; c < 0x10; c++)
+				{
+					_update_frequency_channel(handle, dsp, c);
+				}
+			}
+		} break;
+		case JOB_TYPE_TUNING_FREE:
+		{
+			// never reached
+		} break;
 		default:
 		{
 			// never reached
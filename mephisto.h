@@ -65,6 +65,28 @@
 #define MEPHISTO__fontHeight    MEPHISTO_PREFIX "fontHeight"
 
 #define MEPHISTO__timestamp     MEPHISTO_PREFIX "timestamp"
+#define MEPHISTO__compileQueue  MEPHISTO_PREFIX "compileQueue"
+#define MEPHISTO__tiered        MEPHISTO_PREFIX "tiered"
+#define MEPHISTO__compileOptions MEPHISTO_PREFIX "compileOptions"
+#define MEPHISTO__autoTune      MEPHISTO_PREFIX "autoTune"
+#define MEPHISTO__tunedOptions  MEPHISTO_PREFIX "tunedOptions"
+#define MEPHISTO__target        MEPHISTO_PREFIX "target"
+#define MEPHISTO__compileTimeFactory MEPHISTO_PREFIX "compileTimeFactory"
+#define MEPHISTO__compileTimeInstance MEPHISTO_PREFIX "compileTimeInstance"
+#define MEPHISTO__compileTimeInit MEPHISTO_PREFIX "compileTimeInit"
+#define MEPHISTO__compileTimeClone MEPHISTO_PREFIX "compileTimeClone"
+#define MEPHISTO__compileTimeUi MEPHISTO_PREFIX "compileTimeUi"
+#define MEPHISTO__memoryFactory MEPHISTO_PREFIX "memoryFactory"
+#define MEPHISTO__memoryInstances MEPHISTO_PREFIX "memoryInstances"
+#define MEPHISTO__silenceThreshold MEPHISTO_PREFIX "silenceThreshold"
+#define MEPHISTO__silenceBlocks MEPHISTO_PREFIX "silenceBlocks"
+#define MEPHISTO__parkedVoices  MEPHISTO_PREFIX "parkedVoices"
+#define MEPHISTO__quantization  MEPHISTO_PREFIX "quantization"
+#define MEPHISTO__blockLength   MEPHISTO_PREFIX "blockLength"
+#define MEPHISTO__voiceThreads  MEPHISTO_PREFIX "voiceThreads"
+#define MEPHISTO__voiceLoad     MEPHISTO_PREFIX "voiceLoad"
+#define MEPHISTO__parallel      MEPHISTO_PREFIX "parallel"
+#define MEPHISTO__tuning        MEPHISTO_PREFIX "tuning"
 
 #define MEPHISTO__control_1     MEPHISTO_PREFIX "control_1"
 #define MEPHISTO__control_2     MEPHISTO_PREFIX "control_2"
@@ -169,9 +191,13 @@
 #define MEPHISTO__controlLabel_16    MEPHISTO_PREFIX "controlLabel_16"
 
 #define NCONTROLS 16
-#define MAX_NPROPS (5 + 6*NCONTROLS)
+#define MAX_NPROPS (27 + 6*NCONTROLS)
 #define CODE_SIZE 0x10000 // 64 K
 #define ERROR_SIZE 0x2000 // 8 K
+#define OPTIONS_SIZE 0x400 // 1 K
+#define TARGET_SIZE 0x80 // 128
+#define LOAD_SIZE 0x40 // 64
+#define TUNING_SIZE 0x400 // 1 K
 #define BUF_SIZE (CODE_SIZE * 4)
 #define LABEL_SIZE 0x80 // 128
 
@@ -240,6 +266,28 @@ struct _plugstate_t {
 	int32_t xfade_dur;
 	int32_t font_height;
 	int64_t timestamp;
+	int32_t compile_queue;
+	int32_t tiered;
+	char compile_options [OPTIONS_SIZE];
+	int32_t auto_tune;
+	char tuned_options [OPTIONS_SIZE];
+	char target [TARGET_SIZE];
+	float time_factory;
+	float time_instance;
+	float time_init;
+	float time_clone;
+	float time_ui;
+	int64_t memory_factory;
+	int64_t memory_instances;
+	float silence_threshold;
+	int32_t silence_blocks;
+	int32_t parked_voices;
+	int32_t quantization;
+	int32_t block_length;
+	int32_t voice_threads;
+	char voice_load [LOAD_SIZE];
+	int32_t parallel;
+	char tuning [TUNING_SIZE];
 };
 
 #endif // _MEPHISTO_LV2_H
@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2019-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <string.h>
+
+#include <mephisto_kernel.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#	define KERNEL_X86
+#	include <immintrin.h>
+#endif
+
+static void
+_mix_scalar(float *dst, const float *src, float gain, uint32_t nsamples)
+{
+	for(uint32_t i = 0; i < nsamples; i++)
+	{
+		dst[i] += gain * src[i];
+	}
+}
+
+static void
+_mix_ramp_scalar(float *dst, const float *src, float gain0, float gain1,
+	uint32_t nsamples)
+{
+	const float step = (gain1 - gain0) / nsamples;
+
+	for(uint32_t i = 0; i < nsamples; i++)
+	{
+		dst[i] += (gain0 + step*i) * src[i];
+	}
+}
+
+static void
+_clear_scalar(float *dst, uint32_t nsamples)
+{
+	memset(dst, 0x0, nsamples * sizeof(float));
+}
+
+static void
+_copy_scalar(float *dst, const float *src, uint32_t nsamples)
+{
+	memcpy(dst, src, nsamples * sizeof(float));
+}
+
+#if defined(KERNEL_X86)
+__attribute__((target("sse2")))
+static void
+_mix_sse2(float *dst, const float *src, float gain, uint32_t nsamples)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	uint32_t i = 0;
+
+	for( ; i + 4 <= nsamples; i += 4)
+	{
+		const __m128 d = _mm_loadu_ps(&dst[i]);
+		const __m128 s = _mm_loadu_ps(&src[i]);
+
+		_mm_storeu_ps(&dst[i], _mm_add_ps(d, _mm_mul_ps(g, s)));
+	}
+
+	_mix_scalar(&dst[i], &src[i], gain, nsamples - i);
+}
+
+__attribute__((target("sse2")))
+static void
+_mix_ramp_sse2(float *dst, const float *src, float gain0, float gain1,
+	uint32_t nsamples)
+{
+	const float step = (gain1 - gain0) / nsamples;
+	const __m128 dg = _mm_set1_ps(4*step);
+	__m128 g = _mm_setr_ps(gain0, gain0 + step, gain0 + 2*step, gain0 + 3*step);
+	uint32_t i = 0;
+
+	for( ; i + 4 <= nsamples; i += 4)
+	{
+		const __m128 d = _mm_loadu_ps(&dst[i]);
+		const __m128 s = _mm_loadu_ps(&src[i]);
+
+		_mm_storeu_ps(&dst[i], _mm_add_ps(d, _mm_mul_ps(g, s)));
+		g = _mm_add_ps(g, dg);
+	}
+
+	for( ; i < nsamples; i++)
+	{
+		dst[i] += (gain0 + step*i) * src[i];
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static void
+_mix_avx2(float *dst, const float *src, float gain, uint32_t nsamples)
+{
+	const __m256 g = _mm256_set1_ps(gain);
+	uint32_t i = 0;
+
+	for( ; i + 16 <= nsamples; i += 16)
+	{
+		const __m256 d0 = _mm256_loadu_ps(&dst[i]);
+		const __m256 d1 = _mm256_loadu_ps(&dst[i + 8]);
+		const __m256 s0 = _mm256_loadu_ps(&src[i]);
+		const __m256 s1 = _mm256_loadu_ps(&src[i + 8]);
+
+		_mm256_storeu_ps(&dst[i], _mm256_fmadd_ps(g, s0, d0));
+		_mm256_storeu_ps(&dst[i + 8], _mm256_fmadd_ps(g, s1, d1));
+	}
+
+	for( ; i + 8 <= nsamples; i += 8)
+	{
+		const __m256 d = _mm256_loadu_ps(&dst[i]);
+		const __m256 s = _mm256_loadu_ps(&src[i]);
+
+		_mm256_storeu_ps(&dst[i], _mm256_fmadd_ps(g, s, d));
+	}
+
+	_mix_scalar(&dst[i], &src[i], gain, nsamples - i);
+}
+
+__attribute__((target("avx2,fma")))
+static void
+_mix_ramp_avx2(float *dst, const float *src, float gain0, float gain1,
+	uint32_t nsamples)
+{
+	const float step = (gain1 - gain0) / nsamples;
+	const __m256 dg = _mm256_set1_ps(8*step);
+	__m256 g = _mm256_fmadd_ps(_mm256_set1_ps(step),
+		_mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f),
+		_mm256_set1_ps(gain0));
+	uint32_t i = 0;
+
+	for( ; i + 8 <= nsamples; i += 8)
+	{
+		const __m256 d = _mm256_loadu_ps(&dst[i]);
+		const __m256 s = _mm256_loadu_ps(&src[i]);
+
+		_mm256_storeu_ps(&dst[i], _mm256_fmadd_ps(g, s, d));
+		g = _mm256_add_ps(g, dg);
+	}
+
+	for( ; i < nsamples; i++)
+	{
+		dst[i] += (gain0 + step*i) * src[i];
+	}
+}
+
+// the remainder is handled with masked loads and stores
+__attribute__((target("avx512f")))
+static inline __mmask16
+_tail_avx512(uint32_t n)
+{
+	return (__mmask16)((1U << n) - 1);
+}
+
+__attribute__((target("avx512f")))
+static void
+_mix_avx512(float *dst, const float *src, float gain, uint32_t nsamples)
+{
+	const __m512 g = _mm512_set1_ps(gain);
+	uint32_t i = 0;
+
+	for( ; i + 16 <= nsamples; i += 16)
+	{
+		const __m512 d = _mm512_loadu_ps(&dst[i]);
+		const __m512 s = _mm512_loadu_ps(&src[i]);
+
+		_mm512_storeu_ps(&dst[i], _mm512_fmadd_ps(g, s, d));
+	}
+
+	if(i < nsamples)
+	{
+		const __mmask16 m = _tail_avx512(nsamples - i);
+		const __m512 d = _mm512_maskz_loadu_ps(m, &dst[i]);
+		const __m512 s = _mm512_maskz_loadu_ps(m, &src[i]);
+
+		_mm512_mask_storeu_ps(&dst[i], m, _mm512_fmadd_ps(g, s, d));
+	}
+}
+
+__attribute__((target("avx512f")))
+static void
+_mix_ramp_avx512(float *dst, const float *src, float gain0, float gain1,
+	uint32_t nsamples)
+{
+	const float step = (gain1 - gain0) / nsamples;
+	const __m512 dg = _mm512_set1_ps(16*step);
+	__m512 g = _mm512_fmadd_ps(_mm512_set1_ps(step),
+		_mm512_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f,
+			8.f, 9.f, 10.f, 11.f, 12.f, 13.f, 14.f, 15.f),
+		_mm512_set1_ps(gain0));
+	uint32_t i = 0;
+
+	for( ; i + 16 <= nsamples; i += 16)
+	{
+		const __m512 d = _mm512_loadu_ps(&dst[i]);
+		const __m512 s = _mm512_loadu_ps(&src[i]);
+
+		_mm512_storeu_ps(&dst[i], _mm512_fmadd_ps(g, s, d));
+		g = _mm512_add_ps(g, dg);
+	}
+
+	if(i < nsamples)
+	{
+		const __mmask16 m = _tail_avx512(nsamples - i);
+		const __m512 d = _mm512_maskz_loadu_ps(m, &dst[i]);
+		const __m512 s = _mm512_maskz_loadu_ps(m, &src[i]);
+
+		_mm512_mask_storeu_ps(&dst[i], m, _mm512_fmadd_ps(g, s, d));
+	}
+}
+#endif
+
+static const kernel_t kernels [KERNEL_ISA_MAX] = {
+	[KERNEL_ISA_SCALAR] = {
+		.isa = KERNEL_ISA_SCALAR,
+		.mix = _mix_scalar,
+		.mix_ramp = _mix_ramp_scalar,
+		.clear = _clear_scalar,
+		.copy = _copy_scalar
+	},
+#if defined(KERNEL_X86)
+	[KERNEL_ISA_SSE2] = {
+		.isa = KERNEL_ISA_SSE2,
+		.mix = _mix_sse2,
+		.mix_ramp = _mix_ramp_sse2,
+		.clear = _clear_scalar,
+		.copy = _copy_scalar
+	},
+	[KERNEL_ISA_AVX2] = {
+		.isa = KERNEL_ISA_AVX2,
+		.mix = _mix_avx2,
+		.mix_ramp = _mix_ramp_avx2,
+		.clear = _clear_scalar,
+		.copy = _copy_scalar
+	},
+	[KERNEL_ISA_AVX512] = {
+		.isa = KERNEL_ISA_AVX512,
+		.mix = _mix_avx512,
+		.mix_ramp = _mix_ramp_avx512,
+		.clear = _clear_scalar,
+		.copy = _copy_scalar
+	}
+#endif
+};
+
+const char *
+kernel_isa_name(kernel_isa_t isa)
+{
+	switch(isa)
+	{
+		case KERNEL_ISA_SCALAR:
+			return "scalar";
+		case KERNEL_ISA_SSE2:
+			return "sse2";
+		case KERNEL_ISA_AVX2:
+			return "avx2";
+		case KERNEL_ISA_AVX512:
+			return "avx512";
+		case KERNEL_ISA_MAX:
+			break;
+	}
+
+	return "unknown";
+}
+
+bool
+kernel_isa_supported(kernel_isa_t isa)
+{
+#if defined(KERNEL_X86)
+	__builtin_cpu_init();
+#endif
+
+	switch(isa)
+	{
+		case KERNEL_ISA_SCALAR:
+			return true;
+#if defined(KERNEL_X86)
+		case KERNEL_ISA_SSE2:
+			return __builtin_cpu_supports("sse2");
+		case KERNEL_ISA_AVX2:
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+		case KERNEL_ISA_AVX512:
+			return __builtin_cpu_supports("avx512f");
+#else
+		case KERNEL_ISA_SSE2:
+			// fall-through
+		case KERNEL_ISA_AVX2:
+			// fall-through
+		case KERNEL_ISA_AVX512:
+			return false;
+#endif
+		case KERNEL_ISA_MAX:
+			break;
+	}
+
+	return false;
+}
+
+int
+kernel_init_isa(kernel_t *kernel, kernel_isa_t isa)
+{
+	if( (isa >= KERNEL_ISA_MAX) || !kernel_isa_supported(isa) )
+	{
+		return -1;
+	}
+
+	*kernel = kernels[isa];
+
+	return 0;
+}
+
+void
+kernel_init(kernel_t *kernel)
+{
+	for(int isa = KERNEL_ISA_MAX - 1; isa >= KERNEL_ISA_SCALAR; isa--)
+	{
+		if(kernel_init_isa(kernel, isa) == 0)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2019-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#ifndef _MEPHISTO_KERNEL_H
+#define _MEPHISTO_KERNEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum _kernel_isa_t {
+	KERNEL_ISA_SCALAR = 0,
+	KERNEL_ISA_SSE2,
+	KERNEL_ISA_AVX2,
+	KERNEL_ISA_AVX512,
+
+	KERNEL_ISA_MAX
+} kernel_isa_t;
+
+typedef struct _kernel_t kernel_t;
+
+// buffers need not be aligned, dst and src must not overlap
+struct _kernel_t {
+	kernel_isa_t isa;
+
+	// dst[i] += gain * src[i]
+	void (*mix)(float *dst, const float *src, float gain, uint32_t nsamples);
+
+	// dst[i] += (gain0 + (gain1 - gain0) * i / nsamples) * src[i]
+	void (*mix_ramp)(float *dst, const float *src, float gain0, float gain1,
+		uint32_t nsamples);
+
+	// dst[i] = 0, libc's dispatch beats hand-written variants
+	void (*clear)(float *dst, uint32_t nsamples);
+
+	// dst[i] = src[i], libc's dispatch beats hand-written variants
+	void (*copy)(float *dst, const float *src, uint32_t nsamples);
+};
+
+const char *
+kernel_isa_name(kernel_isa_t isa);
+
+bool
+kernel_isa_supported(kernel_isa_t isa);
+
+// selects the given instruction set, returns -1 if not supported
+int
+kernel_init_isa(kernel_t *kernel, kernel_isa_t isa);
+
+// selects the best instruction set supported by the running CPU
+void
+kernel_init(kernel_t *kernel);
+
+#endif // _MEPHISTO_KERNEL_H
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2019-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include <mephisto_kernel.h>
+
+#define MAX_SAMPLES 4096
+#define NCHECKS 64
+#define NSIZES 7
+#define NROUNDS 5
+#define NOPS 2
+#define TOLERANCE 1e-5f
+
+static const uint32_t sizes [NSIZES] = {
+	32, 64, 128, 256, 512, 1024, 4096
+};
+
+// one spare sample each, to run on unaligned buffers like host offsets do
+static float dst [MAX_SAMPLES + 1];
+static float src [MAX_SAMPLES + 1];
+static float ref [MAX_SAMPLES + 1];
+
+static inline uint64_t
+_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+_fill(float *buf, uint32_t nsamples)
+{
+	for(uint32_t i = 0; i < nsamples; i++)
+	{
+		buf[i] = 2.f * rand() / RAND_MAX - 1.f;
+	}
+}
+
+static float
+_diff(const float *a, const float *b, uint32_t nsamples)
+{
+	float diff = 0.f;
+
+	for(uint32_t i = 0; i < nsamples; i++)
+	{
+		diff = fmaxf(diff, fabsf(a[i] - b[i]));
+	}
+
+	return diff;
+}
+
+// compares against the scalar kernel for all sizes up to NCHECKS samples
+static int
+_check(const kernel_t *kernel, const kernel_t *scalar)
+{
+	for(uint32_t n = 1; n <= NCHECKS; n++)
+	{
+		float *d = dst + 1;
+		float *r = ref + 1;
+		const float *s = src + 1;
+
+		_fill(d, n);
+		kernel->copy(r, d, n);
+		if(_diff(d, r, n) > 0.f)
+		{
+			return -1;
+		}
+
+		kernel->mix(d, s, 0.7f, n);
+		scalar->mix(r, s, 0.7f, n);
+		if(_diff(d, r, n) > TOLERANCE)
+		{
+			return -1;
+		}
+
+		kernel->mix_ramp(d, s, 0.2f, 0.9f, n);
+		scalar->mix_ramp(r, s, 0.2f, 0.9f, n);
+		if(_diff(d, r, n) > TOLERANCE)
+		{
+			return -1;
+		}
+
+		kernel->clear(d, n);
+		scalar->clear(r, n);
+		if(_diff(d, r, n) > 0.f)
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+// best of NROUNDS, in ns per call
+static double
+_bench(const kernel_t *kernel, int op, uint32_t nsamples)
+{
+	const uint32_t ncalls = (1 << 22) / nsamples;
+	float *d = dst + 1;
+	const float *s = src + 1;
+	double best = INFINITY;
+
+	for(unsigned r = 0; r < NROUNDS; r++)
+	{
+		const uint64_t t0 = _clock_ns();
+
+		for(uint32_t c = 0; c < ncalls; c++)
+		{
+			switch(op)
+			{
+				case 0:
+					kernel->mix(d, s, 0.5f, nsamples);
+					break;
+				case 1:
+					kernel->mix_ramp(d, s, 0.f, 1.f, nsamples);
+					break;
+			}
+
+			__asm__ __volatile__("" : : "r"(d) : "memory");
+		}
+
+		const double dt = (double)(_clock_ns() - t0) / ncalls;
+
+		if(dt < best)
+		{
+			best = dt;
+		}
+	}
+
+	return best;
+}
+
+int
+main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
+{
+	// clear and copy are libc's for all instruction sets
+	static const char *ops [NOPS] = {
+		"mix", "mix_ramp"
+	};
+	kernel_t scalar;
+	kernel_t best;
+	int ret = 0;
+
+	kernel_init_isa(&scalar, KERNEL_ISA_SCALAR);
+	kernel_init(&best);
+
+	_fill(src, MAX_SAMPLES + 1);
+	_fill(dst, MAX_SAMPLES + 1);
+
+	printf("selected: %s\n", kernel_isa_name(best.isa));
+
+	for(int isa = KERNEL_ISA_SCALAR; isa < KERNEL_ISA_MAX; isa++)
+	{
+		kernel_t kernel;
+
+		if(kernel_init_isa(&kernel, isa) != 0)
+		{
+			printf("%-8s not supported\n", kernel_isa_name(isa));
+			continue;
+		}
+
+		if(_check(&kernel, &scalar) != 0)
+		{
+			fprintf(stderr, "%-8s mismatch against scalar kernel\n",
+				kernel_isa_name(isa));
+			ret = 1;
+			continue;
+		}
+
+		for(int op = 0; op < NOPS; op++)
+		{
+			printf("%-8s %-8s", kernel_isa_name(isa), ops[op]);
+
+			for(unsigned s = 0; s < NSIZES; s++)
+			{
+				const double ns = _bench(&kernel, op, sizes[s]);
+				const double ref_ns = _bench(&scalar, op, sizes[s]);
+
+				printf(" %4"PRIu32": %7.1f ns (x%.2f)", sizes[s], ns, ref_ns / ns);
+			}
+
+			printf("\n");
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2019-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#	include <linux/futex.h>
+#	include <sys/syscall.h>
+#endif
+
+#include <mephisto_pool.h>
+
+#define POOL_SPIN 1024 // iterations before a helper goes to sleep
+
+typedef struct _lane_t lane_t;
+
+struct _lane_t {
+	pool_t *pool;
+	uint32_t idx;
+	pthread_t thread;
+	_Atomic uint64_t busy; // ns
+	int policy; // applied
+	int priority; // applied
+};
+
+struct _pool_t {
+	pool_cb_t cb;
+	void *data;
+	uint32_t nlanes;
+
+	// helpers wait for the generation to change, the caller only for those
+	// helpers which entered the callback before it was closed
+	_Atomic uint32_t generation;
+	_Atomic uint32_t active;
+	atomic_bool closed;
+	_Atomic uint32_t sleepers;
+	atomic_bool quit;
+
+	// scheduling policy of the calling thread, handed over to the helpers
+	bool sched_known;
+	_Atomic int policy;
+	_Atomic int priority;
+
+	lane_t lanes [POOL_THREADS_MAX];
+};
+
+static inline uint64_t
+_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void
+_pause(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+static inline void
+_wait(_Atomic uint32_t *addr, uint32_t val)
+{
+#if defined(__linux__)
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+	(void)addr;
+	(void)val;
+	sched_yield();
+#endif
+}
+
+static inline void
+_wake(_Atomic uint32_t *addr)
+{
+#if defined(__linux__)
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, POOL_THREADS_MAX, NULL, NULL, 0);
+#else
+	(void)addr;
+#endif
+}
+
+static void
+_lane_sched(lane_t *lane)
+{
+	pool_t *pool = lane->pool;
+	const int policy = atomic_load_explicit(&pool->policy, memory_order_relaxed);
+	const int priority = atomic_load_explicit(&pool->priority,
+		memory_order_relaxed);
+
+	if( (policy == lane->policy) && (priority == lane->priority) )
+	{
+		return;
+	}
+
+	const struct sched_param param = {
+		.sched_priority = priority
+	};
+
+	// needs privileges, helpers keep running at normal priority otherwise
+	pthread_setschedparam(pthread_self(), policy, &param);
+
+	lane->policy = policy;
+	lane->priority = priority;
+}
+
+static inline void
+_lane_call(lane_t *lane)
+{
+	pool_t *pool = lane->pool;
+	const uint64_t t0 = _clock_ns();
+
+	pool->cb(pool->data, lane->idx);
+
+	atomic_fetch_add_explicit(&lane->busy, _clock_ns() - t0,
+		memory_order_relaxed);
+}
+
+static void *
+_lane_thread(void *data)
+{
+	lane_t *lane = data;
+	pool_t *pool = lane->pool;
+	uint32_t seen = 0;
+
+	while(true)
+	{
+		uint32_t gen;
+
+		// spin for a while, blocks follow each other closely
+		for(unsigned i = 0; i < POOL_SPIN; i++)
+		{
+			if( (gen = atomic_load(&pool->generation)) != seen)
+			{
+				break;
+			}
+
+			_pause();
+		}
+
+		while( (gen = atomic_load(&pool->generation)) == seen)
+		{
+			atomic_fetch_add(&pool->sleepers, 1);
+			_wait(&pool->generation, seen);
+			atomic_fetch_sub(&pool->sleepers, 1);
+		}
+
+		seen = gen;
+
+		if(atomic_load(&pool->quit))
+		{
+			break;
+		}
+
+		_lane_sched(lane);
+
+		// the caller may be done already, e.g. when this helper was preempted,
+		// entering a closed run would race with the caller setting up the next one
+		atomic_fetch_add(&pool->active, 1);
+
+		if(!atomic_load(&pool->closed))
+		{
+			_lane_call(lane);
+		}
+
+		atomic_fetch_sub_explicit(&pool->active, 1, memory_order_release);
+	}
+
+	return NULL;
+}
+
+pool_t *
+pool_new(uint32_t nlanes, pool_cb_t cb, void *data)
+{
+	if( (nlanes == 0) || (nlanes > POOL_THREADS_MAX) )
+	{
+		return NULL;
+	}
+
+	pool_t *pool = calloc(1, sizeof(pool_t));
+
+	if(!pool)
+	{
+		return NULL;
+	}
+
+	pool->cb = cb;
+	pool->data = data;
+	atomic_init(&pool->generation, 0);
+	atomic_init(&pool->active, 0);
+	atomic_init(&pool->closed, true);
+	atomic_init(&pool->sleepers, 0);
+	atomic_init(&pool->quit, false);
+	atomic_init(&pool->policy, SCHED_OTHER);
+	atomic_init(&pool->priority, 0);
+
+	for(uint32_t l = 0; l < nlanes; l++)
+	{
+		lane_t *lane = &pool->lanes[l];
+
+		lane->pool = pool;
+		lane->idx = l;
+		lane->policy = SCHED_OTHER;
+		atomic_init(&lane->busy, 0);
+
+		// lane 0 is run by the caller
+		if(l == 0)
+		{
+			pool->nlanes++;
+			continue;
+		}
+
+		if(pthread_create(&lane->thread, NULL, _lane_thread, lane) != 0)
+		{
+			break;
+		}
+
+		pool->nlanes++;
+	}
+
+	if(pool->nlanes < nlanes)
+	{
+		pool_free(pool);
+
+		return NULL;
+	}
+
+	return pool;
+}
+
+void
+pool_free(pool_t *pool)
+{
+	if(!pool)
+	{
+		return;
+	}
+
+	atomic_store(&pool->quit, true);
+	atomic_fetch_add(&pool->generation, 1);
+	_wake(&pool->generation);
+
+	for(uint32_t l = 1; l < pool->nlanes; l++)
+	{
+		pthread_join(pool->lanes[l].thread, NULL);
+	}
+
+	free(pool);
+}
+
+uint32_t
+pool_lanes(pool_t *pool)
+{
+	return pool->nlanes;
+}
+
+void
+pool_run(pool_t *pool)
+{
+	if(!pool->sched_known)
+	{
+		struct sched_param param;
+		int policy;
+
+		if(pthread_getschedparam(pthread_self(), &policy, &param) == 0)
+		{
+			atomic_store_explicit(&pool->policy, policy, memory_order_relaxed);
+			atomic_store_explicit(&pool->priority, param.sched_priority,
+				memory_order_relaxed);
+		}
+
+		pool->sched_known = true;
+	}
+
+	atomic_store(&pool->closed, false);
+	atomic_fetch_add(&pool->generation, 1);
+
+	// only sleeping helpers need a syscall to be woken up
+	if(atomic_load(&pool->sleepers) > 0)
+	{
+		_wake(&pool->generation);
+	}
+
+	_lane_call(&pool->lanes[0]);
+
+	// the work is claimed up by now, helpers which did not make it in time, e.g.
+	// as they were preempted or share a core with the caller, are not waited for
+	atomic_store(&pool->closed, true);
+
+	while(atomic_load_explicit(&pool->active, memory_order_acquire) > 0)
+	{
+		_pause();
+	}
+}
+
+uint64_t
+pool_busy(pool_t *pool, uint32_t lane)
+{
+	return atomic_exchange_explicit(&pool->lanes[lane].busy, 0,
+		memory_order_relaxed);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2019-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#ifndef _MEPHISTO_POOL_H
+#define _MEPHISTO_POOL_H
+
+#include <stdint.h>
+
+#define POOL_THREADS_MAX 8
+
+typedef struct _pool_t pool_t;
+
+// called concurrently by all lanes, lane 0 is the calling thread, helpers may
+// miss a run, the callback thus must hand out its work dynamically
+typedef void (*pool_cb_t)(void *data, uint32_t lane);
+
+// non-rt, spawns nlanes-1 helper threads
+pool_t *
+pool_new(uint32_t nlanes, pool_cb_t cb, void *data);
+
+// non-rt, joins all helper threads
+void
+pool_free(pool_t *pool);
+
+uint32_t
+pool_lanes(pool_t *pool);
+
+// rt-safe, wakes all helpers, runs lane 0 inline and returns once all helpers
+// which joined in are done, helpers follow the scheduling policy of the
+// calling thread
+void
+pool_run(pool_t *pool);
+
+// rt-safe, returns and resets the time spent in the callback since the last
+// call, in ns
+uint64_t
+pool_busy(pool_t *pool, uint32_t lane);
+
+#endif // _MEPHISTO_POOL_H
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2019-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include <faust/dsp/llvm-c-dsp.h>
+
+#define NCHANNELS 8
+#define SRATE 48000
+#define NBLOCKS 4
+#define NVECS 4
+#define NROUNDS 5
+#define WARMUP 8
+#define FRAMES (1 << 16) // per round
+#define ERROR_SIZE 0x1000
+
+// like the audio_8x8 variant, with a resonator bank per channel
+static const char *code =
+	"import(\"stdfaust.lib\");\n"
+	"nbands = 32;\n"
+	"band(c, i) = fi.resonbp(80.0 * pow(2.0, (i + c/8.0) / 4.0), 8.0, 0.1);\n"
+	"bank(c) = _ <: par(i, nbands, band(c, i)) :> _;\n"
+	"process = par(c, 8, bank(c));\n";
+
+static const uint32_t blocks [NBLOCKS] = {
+	64, 256, 1024, 4096
+};
+
+static const char *vecs [NVECS] = {
+	"32", "64", "128", "256"
+};
+
+static float bufs [2*NCHANNELS][4096];
+
+static inline uint64_t
+_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static llvm_dsp_factory *
+_factory(const char *vs, bool parallel)
+{
+	char err [ERROR_SIZE];
+	const char *argv [] = {
+		"-I", FAUST_DSP_DIR,
+		"-vec",
+		"-vs", vs,
+		"-sch"
+	};
+	const int argc = sizeof(argv) / sizeof(*argv) - (parallel ? 0 : 1);
+
+	memset(err, 0x0, sizeof(err));
+
+	llvm_dsp_factory *factory = createCDSPFactoryFromString("mephisto", code,
+		argc, argv, "", err, -1);
+
+	if(!factory)
+	{
+		fprintf(stderr, "-vs %s%s: %s\n", vs, parallel ? " -sch" : "", err);
+	}
+
+	return factory;
+}
+
+// best of NROUNDS, in ns per block
+static double
+_bench(llvm_dsp *instance, uint32_t nsamples)
+{
+	const uint32_t ncalls = FRAMES / nsamples;
+	float *inputs [NCHANNELS];
+	float *outputs [NCHANNELS];
+	double best = INFINITY;
+
+	for(unsigned c = 0; c < NCHANNELS; c++)
+	{
+		inputs[c] = bufs[c];
+		outputs[c] = bufs[NCHANNELS + c];
+	}
+
+	for(unsigned w = 0; w < WARMUP; w++)
+	{
+		computeCDSPInstance(instance, nsamples, inputs, outputs);
+	}
+
+	for(unsigned r = 0; r < NROUNDS; r++)
+	{
+		const uint64_t t0 = _clock_ns();
+
+		for(uint32_t c = 0; c < ncalls; c++)
+		{
+			computeCDSPInstance(instance, nsamples, inputs, outputs);
+		}
+
+		const double dt = (double)(_clock_ns() - t0) / ncalls;
+
+		if(dt < best)
+		{
+			best = dt;
+		}
+	}
+
+	return best;
+}
+
+int
+main(int argc __attribute__((unused)), char **argv __attribute__((unused)))
+{
+	int ret = 0;
+
+	for(unsigned c = 0; c < NCHANNELS; c++)
+	{
+		for(unsigned i = 0; i < 4096; i++)
+		{
+			bufs[c][i] = 2.f * rand() / RAND_MAX - 1.f;
+		}
+	}
+
+	printf("8x8 resonator bank, single-threaded vs. -sch, us per block (speedup)\n");
+
+	for(unsigned v = 0; v < NVECS; v++)
+	{
+		llvm_dsp_factory *serial = _factory(vecs[v], false);
+		llvm_dsp_factory *parallel = _factory(vecs[v], true);
+		llvm_dsp *serial_instance = serial ? createCDSPInstance(serial) : NULL;
+		llvm_dsp *parallel_instance = parallel ? createCDSPInstance(parallel) : NULL;
+
+		if(!serial_instance || !parallel_instance)
+		{
+			ret = 1;
+		}
+		else
+		{
+			initCDSPInstance(serial_instance, SRATE);
+			initCDSPInstance(parallel_instance, SRATE);
+
+			printf("-vs %-4s", vecs[v]);
+
+			for(unsigned b = 0; b < NBLOCKS; b++)
+			{
+				const double serial_ns = _bench(serial_instance, blocks[b]);
+				const double parallel_ns = _bench(parallel_instance, blocks[b]);
+
+				printf(" %4"PRIu32": %7.1f/%7.1f us (x%.2f)", blocks[b],
+					serial_ns * 1e-3, parallel_ns * 1e-3, serial_ns / parallel_ns);
+			}
+
+			printf("\n");
+		}
+
+		if(serial_instance)
+		{
+			deleteCDSPInstance(serial_instance);
+		}
+
+		if(parallel_instance)
+		{
+			deleteCDSPInstance(parallel_instance);
+		}
+
+		if(serial)
+		{
+			deleteCDSPFactory(serial);
+		}
+
+		if(parallel)
+		{
+			deleteCDSPFactory(parallel);
+		}
+	}
+
+	return ret;
+}
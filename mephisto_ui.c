@@ -313,6 +313,132 @@ static const props_def_t defs [MAX_NPROPS] = {
 		.type = LV2_ATOM__Long,
 		.event_cb = _intercept_timestamp
 	},
+	{
+		.property = MEPHISTO__compileQueue,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, compile_queue),
+		.type = LV2_ATOM__Int
+	},
+	{
+		.property = MEPHISTO__tiered,
+		.offset = offsetof(plugstate_t, tiered),
+		.type = LV2_ATOM__Bool
+	},
+	{
+		.property = MEPHISTO__compileOptions,
+		.offset = offsetof(plugstate_t, compile_options),
+		.type = LV2_ATOM__String,
+		.max_size = OPTIONS_SIZE
+	},
+	{
+		.property = MEPHISTO__autoTune,
+		.offset = offsetof(plugstate_t, auto_tune),
+		.type = LV2_ATOM__Bool
+	},
+	{
+		.property = MEPHISTO__tunedOptions,
+		.offset = offsetof(plugstate_t, tuned_options),
+		.type = LV2_ATOM__String,
+		.max_size = OPTIONS_SIZE
+	},
+	{
+		.property = MEPHISTO__target,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, target),
+		.type = LV2_ATOM__String,
+		.max_size = TARGET_SIZE
+	},
+	{
+		.property = MEPHISTO__compileTimeFactory,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, time_factory),
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = MEPHISTO__compileTimeInstance,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, time_instance),
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = MEPHISTO__compileTimeInit,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, time_init),
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = MEPHISTO__compileTimeClone,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, time_clone),
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = MEPHISTO__compileTimeUi,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, time_ui),
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = MEPHISTO__memoryFactory,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, memory_factory),
+		.type = LV2_ATOM__Long
+	},
+	{
+		.property = MEPHISTO__memoryInstances,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, memory_instances),
+		.type = LV2_ATOM__Long
+	},
+	{
+		.property = MEPHISTO__silenceThreshold,
+		.offset = offsetof(plugstate_t, silence_threshold),
+		.type = LV2_ATOM__Float
+	},
+	{
+		.property = MEPHISTO__silenceBlocks,
+		.offset = offsetof(plugstate_t, silence_blocks),
+		.type = LV2_ATOM__Int
+	},
+	{
+		.property = MEPHISTO__parkedVoices,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, parked_voices),
+		.type = LV2_ATOM__Int
+	},
+	{
+		.property = MEPHISTO__quantization,
+		.offset = offsetof(plugstate_t, quantization),
+		.type = LV2_ATOM__Int
+	},
+	{
+		.property = MEPHISTO__blockLength,
+		.offset = offsetof(plugstate_t, block_length),
+		.type = LV2_ATOM__Int
+	},
+	{
+		.property = MEPHISTO__voiceThreads,
+		.offset = offsetof(plugstate_t, voice_threads),
+		.type = LV2_ATOM__Int
+	},
+	{
+		.property = MEPHISTO__voiceLoad,
+		.access = LV2_PATCH__readable,
+		.offset = offsetof(plugstate_t, voice_load),
+		.type = LV2_ATOM__String,
+		.max_size = LOAD_SIZE
+	},
+	{
+		.property = MEPHISTO__parallel,
+		.offset = offsetof(plugstate_t, parallel),
+		.type = LV2_ATOM__Bool
+	},
+	{
+		.property = MEPHISTO__tuning,
+		.offset = offsetof(plugstate_t, tuning),
+		.type = LV2_ATOM__Path,
+		.max_size = TUNING_SIZE
+	},
 	CONTROL(1),
 	CONTROL(2),
 	CONTROL(3),